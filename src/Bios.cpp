@@ -1,7 +1,15 @@
 module Bios;
 
+import Bus;
+
 namespace Bios
 {
+	const u8* GetPointer(u32 addr)
+	{
+		return bios_ptr + addr;
+	}
+
+
 	void Initialize()
 	{
 		if (bios_ptr == nullptr) {
@@ -17,6 +25,7 @@ namespace Bios
 			if (opt_bios.value().size() == 0x4000) {
 				custom_bios = opt_bios.value();
 				bios_ptr = custom_bios.data();
+				Bus::RebuildPageTables();
 				return true;
 			}
 			else {
@@ -48,6 +57,7 @@ namespace Bios
 	{
 		bios_ptr = default_bios.data();
 		custom_bios.clear();
+		Bus::RebuildPageTables();
 	}
 
 
@@ -13,6 +13,7 @@ namespace Bios
 {
 export
 {
+	const u8* GetPointer(u32 addr);
 	void Initialize();
 	bool Load(const std::string& path);
 	template<std::integral Int> Int Read(u32 addr);
@@ -14,11 +14,197 @@ import Timers;
 
 namespace Bus
 {
+	void AdvancePrefetch(u64 now)
+	{
+		/* The global time may be moved back slightly when the scheduler catches up with an event */
+		u64 elapsed = now > prefetch.last_update ? now - prefetch.last_update : 0;
+		prefetch.last_update = now;
+		if (!prefetch.active || prefetch.count == prefetch_buffer_capacity) {
+			return;
+		}
+		if (elapsed < prefetch.countdown) {
+			prefetch.countdown -= uint(elapsed);
+			return;
+		}
+		/* Credit every halfword that has arrived since the last update at once */
+		uint step_cycles = GetPrefetchStepCycles();
+		elapsed -= prefetch.countdown;
+		u64 arrived = 1 + elapsed / step_cycles;
+		if (prefetch.count + arrived >= prefetch_buffer_capacity) {
+			/* Reading stalls until a slot is freed, and then starts over */
+			prefetch.count = prefetch_buffer_capacity;
+			prefetch.countdown = step_cycles;
+		}
+		else {
+			prefetch.count += uint(arrived);
+			prefetch.countdown = step_cycles - uint(elapsed % step_cycles);
+		}
+	}
+
+
+	template<std::integral Int>
+	bool AdvanceSequentialAccess(u32 addr)
+	{
+		bool sequential_access = addr == next_addr_for_sequential_access;
+		next_addr_for_sequential_access = addr + sizeof(Int);
+		return sequential_access;
+	}
+
+
+	template<std::integral Int>
+	void BuildIoHandlerTable()
+	{
+		for (u32 index = 0; index < num_io_halfwords; ++index) {
+			u32 addr = 0x400'0000 + 2 * index;
+			auto& read = io_read_handlers<Int>[index];
+			auto& write = io_write_handlers<Int>[index];
+			if (addr < 0x400'0060) {
+				read = PPU::ReadReg<Int>;
+				write = PPU::WriteReg<Int>;
+			}
+			else if (addr < 0x400'00B0) {
+				read = APU::ReadReg<Int>;
+				write = APU::WriteReg<Int>;
+			}
+			else if (addr < 0x400'0100) {
+				read = DMA::ReadReg<Int>;
+				write = DMA::WriteReg<Int>;
+			}
+			else if (addr < 0x400'0120) {
+				read = Timers::ReadReg<Int>;
+				write = Timers::WriteReg<Int>;
+			}
+			else if (addr < 0x400'0130) {
+				read = Serial::ReadReg<Int>;
+				write = Serial::WriteReg<Int>;
+			}
+			else if (addr < 0x400'0134) {
+				read = Keypad::ReadReg<Int>;
+				write = Keypad::WriteReg<Int>;
+			}
+			else if (addr < 0x400'0200) {
+				read = Serial::ReadReg<Int>;
+				write = Serial::WriteReg<Int>;
+			}
+			else {
+				read = ReadControlReg<Int>;
+				write = WriteControlReg<Int>;
+			}
+		}
+	}
+
+
+	void BuildIoHandlerTables()
+	{
+		BuildIoHandlerTable<u8>();
+		BuildIoHandlerTable<u16>();
+		BuildIoHandlerTable<u32>();
+	}
+
+
+	template<std::integral Int>
+	uint GetAccessCycles(u32 addr, bool sequential)
+	{
+		if (addr & 0xF000'0000) {
+			return 1;
+		}
+		/* The GBA forcefully uses non-sequential timing at the beginning of each 128K-block of gamepak ROM.
+		   Only the gamepak entries differ between sequential and non-sequential accesses, so this can be applied to every region. */
+		sequential &= (addr & 0x1FFFF) != 0;
+		return access_cycles[addr >> 24][sizeof(Int) / 2][sequential];
+	}
+
+
+	CodeRegion GetCodeRegion(u32 addr)
+	{
+		/* Must be kept in sync with Peek. Each region covers a single mirror, and for ROM, a single 128 KiB block,
+		   as the first access of each such block is always non-sequential. */
+		switch (addr >> 24) {
+		case 0x0:
+			if (addr <= 0x3FFF) return { Bios::GetPointer(0), 0, 0x4000 };
+			return {};
+
+		case 0x2: {
+			u32 start = addr & ~0x3FFFF;
+			return { board_wram.data(), start, 0x40000 };
+		}
+
+		case 0x3: {
+			u32 start = addr & ~0x7FFF;
+			return { chip_wram.data(), start, 0x8000 };
+		}
+
+		case 0x8: case 0x9: case 0xA: case 0xB: case 0xC: case 0xD: {
+			u32 size = std::min(Cartridge::GetRomSize(), 0x20000u);
+			if (size == 0 || IsPrefetchedCode(addr)) return {};
+			u32 start = addr & ~(size - 1);
+			return { Cartridge::GetRomPointer(start), start, size };
+		}
+
+		default:
+			return {};
+		}
+	}
+
+
+	u8* GetHostPointer(u32 addr)
+	{
+		/* Memory that can be read and written directly without side effects. Still, writes to WRAM must invalidate cached blocks,
+		   and writes to video memory must be marked with PPU::MarkDirty. */
+		switch (addr >> 24) {
+		case 0x2: return board_wram.data() + (addr & 0x3FFFF);
+		case 0x3: return chip_wram.data() + (addr & 0x7FFF);
+		case 0x5: return PPU::GetPaletteRamPointer(addr);
+		case 0x6: return PPU::GetVramPointer(addr);
+		case 0x7: return PPU::GetOamPointer(addr);
+		default: return nullptr;
+		}
+	}
+
+
+	template<std::integral Int>
+	uint GetPrefetchedCodeCycles(u32 addr, bool sequential)
+	{
+		u64 now = Scheduler::GetGlobalTime();
+		AdvancePrefetch(now);
+		if (!prefetch.active || addr != prefetch.head) {
+			/* Miss: the opcode is read from the cartridge as usual, and prefetching resumes behind it */
+			uint cycles = GetAccessCycles<Int>(addr, sequential);
+			prefetch.active = true;
+			prefetch.head = addr + sizeof(Int);
+			prefetch.count = 0;
+			prefetch.countdown = GetPrefetchStepCycles();
+			prefetch.last_update = now + cycles;
+			return cycles;
+		}
+		u64 time = now;
+		for (uint i = 0; i < sizeof(Int) / 2; ++i) {
+			/* A buffered halfword takes one cycle; otherwise, the one being read is handed over as soon as it arrives */
+			time += prefetch.count > 0 ? 1 : prefetch.countdown;
+			AdvancePrefetch(time);
+			--prefetch.count;
+			prefetch.head += 2;
+		}
+		return uint(time - now);
+	}
+
+
+	uint GetPrefetchStepCycles()
+	{
+		/* Prefetching reads sequentially. Crossing into a new 128 KiB block is not accounted for. */
+		return std::max(1u, uint(access_cycles[prefetch.head >> 24 & 0xF][1][1]));
+	}
+
+
 	void Initialize()
 	{
 		std::memset(&waitcnt, 0, sizeof(waitcnt));
-		board_wram.fill(0);
-		chip_wram.fill(0);
+		prefetch = {};
+		UpdateAccessCycles();
+		BuildIoHandlerTables();
+		std::ranges::fill(board_wram, 0);
+		std::ranges::fill(chip_wram, 0);
+		RebuildPageTables();
 	}
 
 
@@ -144,6 +330,39 @@ namespace Bus
 	}
 
 
+	bool IsPrefetchedCode(u32 addr)
+	{
+		/* Whether the time taken by opcode fetches from 'addr' depends on the state of the prefetch buffer */
+		return waitcnt.prefetch_buffer_enable && addr >> 24 >= 0x8 && addr >> 24 <= 0xD;
+	}
+
+
+	template<std::integral Int>
+	Int Peek(u32 addr)
+	{
+		/* Reads memory that code can be executed from, without side effects or cycle accounting */
+		Int val;
+		switch (addr >> 24 & 0xF) {
+		case 0x0:
+			return addr <= 0x3FFF ? Bios::Read<Int>(addr) : ReadOpenBus<Int>(addr);
+
+		case 0x2:
+			std::memcpy(&val, board_wram.data() + (addr & 0x3FFFF), sizeof(Int));
+			return val;
+
+		case 0x3:
+			std::memcpy(&val, chip_wram.data() + (addr & 0x7FFF), sizeof(Int));
+			return val;
+
+		case 0x8: case 0x9: case 0xA: case 0xB: case 0xC: case 0xD:
+			return Cartridge::ReadRom<Int>(addr);
+
+		default:
+			return ReadOpenBus<Int>(addr);
+		}
+	}
+
+
 	template<std::integral Int, Scheduler::DriverType driver>
 	Int Read(u32 addr)
 	{
@@ -152,11 +371,18 @@ namespace Bus
 		bool sequential_access = addr == next_addr_for_sequential_access;
 		next_addr_for_sequential_access = addr + sizeof(Int);
 
+		if (addr >> 27 == 1) { /* data accesses to the GamePak take the bus away from the prefetch unit */
+			prefetch.active = false;
+		}
+
 		Int val;
-		uint cycles;
-		if (addr & 0xF000'0000) { /* 1000'0000-FFFF'FFFF   Not used (upper 4bits of address bus unused) */
+		uint cycles = GetAccessCycles<Int>(addr, sequential_access);
+		u32 page = addr >> page_shift;
+		if (page < num_pages && read_pages[page]) {
+			std::memcpy(&val, read_pages[page] + (addr & page_offset_mask), sizeof(Int));
+		}
+		else if (addr & 0xF000'0000) { /* 1000'0000-FFFF'FFFF   Not used (upper 4bits of address bus unused) */
 			val = ReadOpenBus<Int>(addr);
-			cycles = 1;
 		}
 		else {
 			switch (addr >> 24 & 0xF) {
@@ -164,45 +390,34 @@ namespace Bus
 				val = addr <= 0x3FFF
 					? Bios::Read<Int>(addr)
 					: ReadOpenBus<Int>(addr);
-				cycles = 1;
 				break;
 
 			case 0x1: /* not used */
 				val = ReadOpenBus<Int>(addr);
-				cycles = 1;
 				break;
 
 			case 0x2: /* 0200'0000-0203'FFFF   WRAM - On-board Work RAM */
 				std::memcpy(&val, board_wram.data() + (addr & 0x3FFFF), sizeof(Int));
-				if constexpr (sizeof(Int) == 4) cycles = 6;
-				else                            cycles = 3;
 				break;
 
 			case 0x3: /* 0300'0000-0300'7FFF   WRAM - On-chip Work RAM */
 				std::memcpy(&val, chip_wram.data() + (addr & 0x7FFF), sizeof(Int));
-				cycles = 1;
 				break;
 
 			case 0x4: /* 0400'0000-0400'03FE   I/O Registers */
 				val = ReadIo<Int>(addr);
-				cycles = 1;
 				break;
 
 			case 0x5: /* 0500'0000-0500'03FF   BG/OBJ Palette RAM */
 				val = PPU::ReadPaletteRam<Int>(addr);
-				if constexpr (sizeof(Int) == 4) cycles = 2;
-				else                            cycles = 1;
 				break;
 
 			case 0x6: /* 0600'0000-0601'7FFF   VRAM - Video RAM */
 				val = PPU::ReadVram<Int>(addr);
-				if constexpr (sizeof(Int) == 4) cycles = 2;
-				else                            cycles = 1;
 				break;
 
 			case 0x7: /* 0700'0000-0700'03FF   OAM - OBJ Attributes */
 				val = PPU::ReadOam<Int>(addr);
-				cycles = 1;
 				break;
 
 			case 0x8: /* 0800'0000-09FF'FFFF   Game Pak ROM/FlashROM (max 32MB) - Wait State 0 */
@@ -210,22 +425,23 @@ namespace Bus
 			case 0xA: /* 0A00'0000-0BFF'FFFF   Game Pak ROM/FlashROM (max 32MB) - Wait State 1 */
 			case 0xB:
 			case 0xC: /* 0C00'0000-0DFF'FFFF   Game Pak ROM/FlashROM (max 32MB) - Wait State 2 */
-			case 0xD: {
 				val = Cartridge::ReadRom<Int>(addr);
-				sequential_access &= (addr & 0x1FFFF) != 0; /* The GBA forcefully uses non-sequential timing at the beginning of each 128K-block of gamepak ROM */
-				auto wait_state = addr >> 25 & 3;
-				cycles = waitcnt.cart_wait[wait_state][sequential_access];
-				/* GamePak uses 16bit data bus, so that a 32bit access is split into TWO 16bit accesses (of which, the second fragment is always sequential, even if the first fragment was non-sequential). */
-				if constexpr (sizeof(Int) == 4) {
-					cycles += waitcnt.cart_wait[wait_state][1];
+				break;
+
+			case 0xD: /* 0D00'0000-0DFF'FFFF   Game Pak ROM, or EEPROM on carts with one */
+				if (Cartridge::IsEepromAddress(addr)) {
+					val = Int(Cartridge::ReadEeprom());
+					CPU::NotifyDeviceRead(addr);
+				}
+				else {
+					val = Cartridge::ReadRom<Int>(addr);
 				}
-			} break;
+				break;
 
 			case 0xE: /* 0E00'0000-0E00'FFFF   Game Pak SRAM    (max 64 KBytes) - 8bit Bus width */
 				if constexpr (sizeof(Int) == 1) {
 					if (addr <= 0x0E00'FFFF) {
 						val = Cartridge::ReadSram(addr);
-						cycles = waitcnt.sram_wait;
 					}
 					else {
 						val = ReadOpenBus<Int>(addr);
@@ -234,13 +450,11 @@ namespace Bus
 				}
 				else {
 					val = ReadOpenBus<Int>(addr); /* TODO: what should happen? */
-					cycles = 1;
 				}
 				break;
 
 			case 0xF:
 				val = ReadOpenBus<Int>(addr);
-				cycles = 1;
 				break;
 
 			default:
@@ -259,72 +473,114 @@ namespace Bus
 
 
 	template<std::integral Int>
-	Int ReadIo(u32 addr)
+	Int ReadCode(u32 addr)
 	{
-		/* Reads are aligned, and all regions start at word-aligned addresses, so there cannot be a cross-region read. */
-		/* TODO: measure if jump table will be faster */
-		Int ret = [&] {
-			if (addr < 0x400'0060) {
-				return PPU::ReadReg<Int>(addr);
-			}
-			else if (addr < 0x400'00B0) {
-				return APU::ReadReg<Int>(addr);
-			}
-			else if (addr < 0x400'0100) {
-				return DMA::ReadReg<Int>(addr);
-			}
-			else if (addr < 0x400'0120) {
-				return Timers::ReadReg<Int>(addr);
-			}
-			else if (addr < 0x400'0130) {
-				return Serial::ReadReg<Int>(addr);
-			}
-			else if (addr < 0x400'0134) {
-				return Keypad::ReadReg<Int>(addr);
-			}
-			else if (addr < 0x400'0200) {
-				return Serial::ReadReg<Int>(addr);
-			}
-			else {
-				auto ReadByte = [](u32 addr) {
-					switch (addr) {
-					case ADDR_IE:          return IRQ::ReadIE(0);
-					case ADDR_IE + 1:      return IRQ::ReadIE(1);
-					case ADDR_IF:          return IRQ::ReadIF(0);
-					case ADDR_IF + 1:      return IRQ::ReadIF(1);
-					case ADDR_IME:         return u8(IRQ::ReadIME());
-					case ADDR_IME + 1:     u8(0);
-					case ADDR_WAITCNT:     return GetByte(waitcnt.raw, 0);
-					case ADDR_WAITCNT + 1: return GetByte(waitcnt.raw, 1);
-					default: return ReadOpenBus<u8>(addr);
-					}
-				};
-				auto ReadHalf = [](u32 addr) {
-					switch (addr) {
-					case ADDR_IE:      return IRQ::ReadIE();
-					case ADDR_IF:      return IRQ::ReadIF();
-					case ADDR_IME:     return IRQ::ReadIME();
-					case ADDR_WAITCNT: return waitcnt.raw;
-					default: return ReadOpenBus<u16>(addr);
-					}
-				};
-				if constexpr (sizeof(Int) == 1) {
-					return Int(ReadByte(addr));
-				}
-				if constexpr (sizeof(Int) == 2) {
-					return Int(ReadHalf(addr));
+		/* Opcode fetch by the CPU */
+		if (!IsPrefetchedCode(addr)) {
+			return Read<Int>(addr);
+		}
+		bool sequential_access = AdvanceSequentialAccess<Int>(addr);
+		CPU::AddCycles(GetPrefetchedCodeCycles<Int>(addr, sequential_access));
+		return Cartridge::ReadRom<Int>(addr);
+	}
+
+
+	void RebuildPageTables()
+	{
+		if (fastmem_arena) {
+			UpdateFastmemReadOnlyRegions();
+		}
+		read_pages.fill(nullptr);
+		write_pages.fill(nullptr);
+		byte_write_pages.fill(nullptr);
+		for (u32 page = 0; page < num_pages; ++page) {
+			u32 addr = page << page_shift;
+			switch (addr >> 24) {
+			case 0x0:
+				if (addr <= 0x3FFF) {
+					read_pages[page] = Bios::GetPointer(addr);
 				}
-				if constexpr (sizeof(Int) == 4) {
-					u16 lo = ReadHalf(addr);
-					u16 hi = ReadHalf(addr + 2);
-					return Int(lo | hi << 16);
+				break;
+
+			case 0x2:
+				read_pages[page] = write_pages[page] = byte_write_pages[page] = board_wram.data() + (addr & 0x3FFFF);
+				break;
+
+			case 0x3:
+				read_pages[page] = write_pages[page] = byte_write_pages[page] = chip_wram.data() + (addr & 0x7FFF);
+				break;
+
+			case 0x6:
+				write_pages[page] = PPU::GetVramPointer(addr);
+				break;
+
+			case 0x8: case 0x9: case 0xA: case 0xB: case 0xC: case 0xD:
+				if (Cartridge::GetRomSize() >= 1u << page_shift && !Cartridge::IsEepromAddress(addr | page_offset_mask)) {
+					read_pages[page] = Cartridge::GetRomPointer(addr);
 				}
+				break;
+			}
+		}
+		/* The tables are rebuilt when the memory behind them changes (a new BIOS or ROM, WRAM moved into the fastmem arena).
+		   Blocks decoded from the old contents, and the fetch page pointing into them, must not survive that. */
+		CPU::FlushBlockCache();
+	}
+
+
+	template<std::integral Int>
+	Int ReadControlReg(u32 addr)
+	{
+		/* Interrupt, waitstate and power-down control */
+		auto ReadByte = [](u32 addr) {
+			switch (addr) {
+			case ADDR_IE:          return IRQ::ReadIE(0);
+			case ADDR_IE + 1:      return IRQ::ReadIE(1);
+			case ADDR_IF:          return IRQ::ReadIF(0);
+			case ADDR_IF + 1:      return IRQ::ReadIF(1);
+			case ADDR_IME:         return u8(IRQ::ReadIME());
+			case ADDR_IME + 1:     u8(0);
+			case ADDR_WAITCNT:     return GetByte(waitcnt.raw, 0);
+			case ADDR_WAITCNT + 1: return GetByte(waitcnt.raw, 1);
+			default: return ReadOpenBus<u8>(addr);
 			}
-		}();
+		};
+		auto ReadHalf = [](u32 addr) {
+			switch (addr) {
+			case ADDR_IE:      return IRQ::ReadIE();
+			case ADDR_IF:      return IRQ::ReadIF();
+			case ADDR_IME:     return IRQ::ReadIME();
+			case ADDR_WAITCNT: return waitcnt.raw;
+			default: return ReadOpenBus<u16>(addr);
+			}
+		};
+		if constexpr (sizeof(Int) == 1) {
+			return Int(ReadByte(addr));
+		}
+		if constexpr (sizeof(Int) == 2) {
+			return Int(ReadHalf(addr));
+		}
+		if constexpr (sizeof(Int) == 4) {
+			u16 lo = ReadHalf(addr);
+			u16 hi = ReadHalf(addr + 2);
+			return Int(lo | hi << 16);
+		}
+	}
+
+
+	template<std::integral Int>
+	Int ReadIo(u32 addr)
+	{
+		/* Reads are aligned, and all regions start at word-aligned addresses, so there cannot be a cross-region read. */
+		using UInt = std::make_unsigned_t<Int>;
+		u32 index = (addr & 0xFF'FFFF) >> 1;
+		Int ret = index < num_io_halfwords
+			? Int(io_read_handlers<UInt>[index](addr))
+			: Int(ReadOpenBus<UInt>(addr));
 
 		if constexpr (Debug::log_io_reads) {
 			Debug::LogIoAccess<IoOperation::Read>(addr, ret);
 		}
+		CPU::NotifyDeviceRead(addr);
 		return ret;
 	}
 
@@ -336,6 +592,26 @@ namespace Bus
 	}
 
 
+	void UpdateAccessCycles()
+	{
+		for (auto& region : access_cycles) {
+			region = {{ {1, 1}, {1, 1}, {1, 1} }};
+		}
+		access_cycles[0x2] = {{ {3, 3}, {3, 3}, {6, 6} }};
+		access_cycles[0x5] = access_cycles[0x6] = {{ {1, 1}, {1, 1}, {2, 2} }};
+		for (uint region = 0x8; region <= 0xD; ++region) {
+			auto& wait = waitcnt.cart_wait[(region - 8) >> 1];
+			for (uint seq = 0; seq < 2; ++seq) {
+				access_cycles[region][0][seq] = access_cycles[region][1][seq] = wait[seq];
+				/* GamePak uses 16bit data bus, so that a 32bit access is split into TWO 16bit accesses (of which, the second fragment is always sequential, even if the first fragment was non-sequential). */
+				access_cycles[region][2][seq] = wait[seq] + wait[1];
+			}
+		}
+		access_cycles[0xE][0] = { waitcnt.sram_wait, waitcnt.sram_wait };
+		prefetch.active = false; /* progress so far was timed with the old waitstates */
+	}
+
+
 	template<std::integral Int, Scheduler::DriverType driver>
 	void Write(u32 addr, Int data)
 	{
@@ -344,20 +620,38 @@ namespace Bus
 		bool sequential_access = addr == next_addr_for_sequential_access;
 		next_addr_for_sequential_access = addr + sizeof(Int);
 
+		if (addr >> 27 == 1) {
+			prefetch.active = false;
+		}
+
 		uint cycles;
-		if (addr & 0xF000'0000) { /* 1000'0000-FFFF'FFFF   Not used (upper 4bits of address bus unused) */
+		u32 page = addr >> page_shift;
+		u8* page_ptr = page < num_pages ? (sizeof(Int) == 1 ? byte_write_pages[page] : write_pages[page]) : nullptr;
+		if (page_ptr) {
+			std::memcpy(page_ptr + (addr & page_offset_mask), &data, sizeof(Int));
+			if (addr >> 25 == 1) { /* WRAM */
+				CPU::InvalidateBlocks(addr);
+			}
+			else if (addr >> 24 == 6) {
+				PPU::MarkDirty(addr, sizeof(Int));
+			}
+			cycles = GetAccessCycles<Int>(addr, sequential_access);
+		}
+		else if (addr & 0xF000'0000) { /* 1000'0000-FFFF'FFFF   Not used (upper 4bits of address bus unused) */
 			cycles = 1;
 		}
 		else {
 			switch (addr >> 24 & 0xF) {
 			case 0x2: /* 0200'0000-0203'FFFF   WRAM - On-board Work RAM */
 				std::memcpy(board_wram.data() + (addr & 0x3FFFF), &data, sizeof(Int));
+				CPU::InvalidateBlocks(addr);
 				if constexpr (sizeof(Int) == 4) cycles = 6;
 				else                            cycles = 3;
 				break;
 
 			case 0x3: /* 0300'0000-0300'7FFF   WRAM - On-chip Work RAM */
 				std::memcpy(chip_wram.data() + (addr & 0x7FFF), &data, sizeof(Int));
+				CPU::InvalidateBlocks(addr);
 				cycles = 1;
 				break;
 
@@ -411,6 +705,16 @@ namespace Bus
 				}
 				break;
 
+			case 0xD: /* 0D00'0000-0DFF'FFFF   EEPROM, on carts with one */
+				if (Cartridge::IsEepromAddress(addr)) {
+					Cartridge::WriteEeprom(u16(data));
+					cycles = GetAccessCycles<Int>(addr, sequential_access);
+				}
+				else {
+					cycles = 1;
+				}
+				break;
+
 			default:
 				cycles = 1;
 			}
@@ -425,60 +729,53 @@ namespace Bus
 
 
 	template<std::integral Int>
-	void WriteIo(u32 addr, Int data)
+	void WriteControlReg(u32 addr, Int data)
 	{
-		/* Writes are aligned, and all regions start at word-aligned addresses, so there cannot be a cross-region write. */
-		if (addr < 0x400'0060) {
-			PPU::WriteReg(addr, data);
-		}
-		else if (addr < 0x400'00B0) {
-			APU::WriteReg(addr, data);
-		}
-		else if (addr < 0x400'0100) {
-			DMA::WriteReg(addr, data);
-		}
-		else if (addr < 0x400'0120) {
-			Timers::WriteReg(addr, data);
-		}
-		else if (addr < 0x400'0130) {
-			Serial::WriteReg(addr, data);
+		/* Interrupt, waitstate and power-down control */
+		auto WriteByte = [](u32 addr, u8 data) {
+			switch (addr) {
+			case ADDR_IE:          IRQ::WriteIE(data, 0); break;
+			case ADDR_IE + 1:      IRQ::WriteIE(data, 1); break;
+			case ADDR_IF:          IRQ::WriteIF(data, 0); break;
+			case ADDR_IF + 1:      IRQ::WriteIF(data, 1); break;
+			case ADDR_IME:         IRQ::WriteIME(data); break;
+			case ADDR_WAITCNT:     WriteWaitcntLo(data); break;
+			case ADDR_WAITCNT + 1: WriteWaitcntHi(data); break;
+			/* Stop mode (bit 7 set) is deliberately treated as halt: the PPU and timers keep running, and any enabled
+			   interrupt wakes the CPU. Games only use stop to save battery, so the difference goes unnoticed. */
+			case ADDR_HALTCNT:     CPU::Halt(); break;
+			}
+		};
+		auto WriteHalf = [](u32 addr, u16 data) {
+			switch (addr) {
+			case ADDR_IE:      IRQ::WriteIE(data); break;
+			case ADDR_IF:      IRQ::WriteIF(data); break;
+			case ADDR_IME:     IRQ::WriteIME(data); break;
+			case ADDR_WAITCNT: WriteWaitcnt(data); break;
+			case ADDR_POSTFLG: CPU::Halt(); break; /* the upper byte is HALTCNT */
+			}
+		};
+		if constexpr (sizeof(Int) == 1) {
+			WriteByte(addr, data);
 		}
-		else if (addr < 0x400'0134) {
-			Keypad::WriteReg(addr, data);
+		if constexpr (sizeof(Int) == 2) {
+			WriteHalf(addr, data);
 		}
-		else if (addr < 0x400'0200) {
-			Serial::WriteReg(addr, data);
+		if constexpr (sizeof(Int) == 4) {
+			WriteHalf(addr, data & 0xFFFF);
+			WriteHalf(addr + 2, data >> 16 & 0xFFFF);
 		}
-		else {
-			auto WriteByte = [](u32 addr, u8 data) {
-				switch (addr) {
-				case ADDR_IE:          IRQ::WriteIE(data, 0); break;
-				case ADDR_IE + 1:      IRQ::WriteIE(data, 1); break;
-				case ADDR_IF:          IRQ::WriteIF(data, 0); break;
-				case ADDR_IF + 1:      IRQ::WriteIF(data, 1); break;
-				case ADDR_IME:         IRQ::WriteIME(data); break;
-				case ADDR_WAITCNT:     WriteWaitcntLo(data); break;
-				case ADDR_WAITCNT + 1: WriteWaitcntHi(data); break;
-				}
-			};
-			auto WriteHalf = [](u32 addr, u16 data) {
-				switch (addr) {
-				case ADDR_IE:      IRQ::WriteIE(data); break;
-				case ADDR_IF:      IRQ::WriteIF(data); break;
-				case ADDR_IME:     IRQ::WriteIME(data); break;
-				case ADDR_WAITCNT: WriteWaitcnt(data); break;
-				}
-			};
-			if constexpr (sizeof(Int) == 1) {
-				WriteByte(addr, data);
-			}
-			if constexpr (sizeof(Int) == 2) {
-				WriteHalf(addr, data);
-			}
-			if constexpr (sizeof(Int) == 4) {
-				WriteHalf(addr, data & 0xFFFF);
-				WriteHalf(addr + 2, data >> 16 & 0xFFFF);
-			}
+	}
+
+
+	template<std::integral Int>
+	void WriteIo(u32 addr, Int data)
+	{
+		/* Writes are aligned, and all regions start at word-aligned addresses, so there cannot be a cross-region write. */
+		using UInt = std::make_unsigned_t<Int>;
+		u32 index = (addr & 0xFF'FFFF) >> 1;
+		if (index < num_io_halfwords) {
+			io_write_handlers<UInt>[index](addr, UInt(data));
 		}
 
 		if constexpr (Debug::log_io_writes) {
@@ -500,6 +797,8 @@ namespace Bus
 		waitcnt.phi_terminal_output = data >> 11 & 3;
 		waitcnt.prefetch_buffer_enable = data & 0x4000;
 		waitcnt.game_pak_type_flag = data & 0x8000;
+		UpdateAccessCycles();
+		CPU::FlushBlockCache(); /* cached instruction timings depend on the waitstates */
 	}
 
 
@@ -511,6 +810,8 @@ namespace Bus
 		waitcnt.cart_wait[0][1] = cart_wait_2nd_access[0][data >> 4 & 1];
 		waitcnt.cart_wait[1][0] = cart_wait_1st_access   [data >> 5 & 3];
 		waitcnt.cart_wait[1][1] = cart_wait_2nd_access[1][data >> 7 & 1];
+		UpdateAccessCycles();
+		CPU::FlushBlockCache(); /* cached instruction timings depend on the waitstates */
 	}
 
 
@@ -522,6 +823,8 @@ namespace Bus
 		waitcnt.phi_terminal_output = data >> 3 & 3;
 		waitcnt.prefetch_buffer_enable = data & 0x40;
 		waitcnt.game_pak_type_flag = data & 0x80;
+		UpdateAccessCycles();
+		CPU::FlushBlockCache(); /* cached instruction timings depend on the waitstates */
 	}
 
 #define ENUM_READ_WRITE_TEMPL_SPEC(DRIVER)      \
@@ -543,4 +846,16 @@ namespace Bus
 	ENUM_READ_WRITE_TEMPL_SPEC(Scheduler::DriverType::Dma1);
 	ENUM_READ_WRITE_TEMPL_SPEC(Scheduler::DriverType::Dma2);
 	ENUM_READ_WRITE_TEMPL_SPEC(Scheduler::DriverType::Dma3);
+
+	template bool AdvanceSequentialAccess<u16>(u32);
+	template bool AdvanceSequentialAccess<u32>(u32);
+	template uint GetAccessCycles<u16>(u32, bool);
+	template uint GetAccessCycles<u32>(u32, bool);
+	template uint GetPrefetchedCodeCycles<u16>(u32, bool);
+	template uint GetPrefetchedCodeCycles<u32>(u32, bool);
+	template u8 Peek<u8>(u32);
+	template u16 Peek<u16>(u32);
+	template u32 Peek<u32>(u32);
+	template u16 ReadCode<u16>(u32);
+	template u32 ReadCode<u32>(u32);
 }
\ No newline at end of file
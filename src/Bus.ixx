@@ -3,11 +3,14 @@ export module Bus;
 import Scheduler;
 import Util;
 
+import <algorithm>;
 import <array>;
 import <concepts>;
 import <cstring>;
 import <optional>;
+import <span>;
 import <string_view>;
+import <type_traits>;
 
 namespace Bus
 {
@@ -136,14 +139,44 @@ namespace Bus
 			Read, Write
 		};
 
+		/* A range of guest memory that code can be fetched from with plain host loads, at a uniform access time
+		   (apart from the first access, which may be forced non-sequential) */
+		struct CodeRegion {
+			const u8* host_ptr; /* host address of 'start' */
+			u32 start;
+			u32 size; /* 0 if the memory at the requested address cannot be read directly */
+		};
+
+		template<std::integral Int> bool AdvanceSequentialAccess(u32 addr);
+		template<std::integral Int> uint GetAccessCycles(u32 addr, bool sequential);
+		CodeRegion GetCodeRegion(u32 addr);
+		u8* GetHostPointer(u32 addr);
+		template<std::integral Int> uint GetPrefetchedCodeCycles(u32 addr, bool sequential);
 		void Initialize();
+		bool EnableFastmem();
+		u8* GetFastmemArena();
 		constexpr std::optional<std::string_view> IoAddrToStr(u32 addr);
+		bool IsPrefetchedCode(u32 addr);
+		template<std::integral Int> Int Peek(u32 addr);
 		template<std::integral Int, Scheduler::DriverType driver = Scheduler::DriverType::Cpu> Int Read(u32 addr);
+		template<std::integral Int> Int ReadCode(u32 addr);
 		template<std::integral Int> Int ReadOpenBus(u32 addr);
+		void RebuildPageTables();
 		template<std::integral Int, Scheduler::DriverType driver = Scheduler::DriverType::Cpu> void Write(u32 addr, Int data);
+
+		/* Address at which the next access is sequential to the last one. Read and written by JIT code,
+		   which times the opcode fetches of a block without calling AdvanceSequentialAccess. */
+		u32 next_addr_for_sequential_access;
 	}
 
+	void AdvancePrefetch(u64 now);
+	template<std::integral Int> void BuildIoHandlerTable();
+	void BuildIoHandlerTables();
+	uint GetPrefetchStepCycles();
+	template<std::integral Int> Int ReadControlReg(u32 addr);
 	template<std::integral Int> Int ReadIo(u32 addr);
+	void UpdateAccessCycles();
+	template<std::integral Int> void WriteControlReg(u32 addr, Int data);
 	template<std::integral Int> void WriteIo(u32 addr, Int data);
 	void WriteWaitcnt(u16 data);
 	void WriteWaitcntLo(u8 data);
@@ -163,8 +196,59 @@ namespace Bus
 		u16 raw;
 	} waitcnt;
 
-	u32 next_addr_for_sequential_access;
+	/* GamePak prefetch buffer. While enabled, the cartridge keeps reading the halfwords that follow the last opcode fetched from ROM
+	   whenever the CPU leaves the GamePak bus alone, and holds up to eight of them. Opcode fetches that hit the buffer take one cycle
+	   per halfword. Progress is not stepped cycle by cycle, but credited in bulk from the time elapsed since the last update. */
+	constexpr uint prefetch_buffer_capacity = 8;
+
+	struct PrefetchBuffer {
+		u64 last_update; /* global time */
+		u32 head; /* address of the next halfword to be handed to the CPU */
+		uint count; /* halfwords held in the buffer */
+		uint countdown; /* cycles until the halfword being read arrives */
+		bool active;
+	} prefetch;
+
+	/* Handlers for the I/O registers, per halfword of 0400'0000-0400'03FF and per access width (u8, u16, u32). Built at startup. */
+	constexpr u32 num_io_halfwords = 0x200;
+	template<std::integral Int> std::array<Int(*)(u32), num_io_halfwords> io_read_handlers;
+	template<std::integral Int> std::array<void(*)(u32, Int), num_io_halfwords> io_write_handlers;
+
+	/* Cycles taken by an access, indexed by region (address bits 24-27), width (byte, halfword, word) and sequential access.
+	   Rebuilt on WAITCNT writes. */
+	std::array<std::array<std::array<u8, 2>, 3>, 16> access_cycles;
+
+	/* Page tables covering the 28-bit address space, with host pointers for memory that can be accessed without side effects
+	   (apart from WRAM writes invalidating cached blocks). Accesses to pages without one go through the region handlers. Not mapped:
+	   I/O, SRAM, palette RAM and OAM (smaller than a page), VRAM reads (only allowed during blanking), ROMs smaller than a page,
+	   and ROM pages overlapping the EEPROM. */
+	constexpr uint page_shift = 14; /* 16 KiB pages */
+	constexpr uint num_pages = 0x1000'0000 >> page_shift;
+	constexpr u32 page_offset_mask = (1 << page_shift) - 1;
+
+	std::array<const u8*, num_pages> read_pages;
+	std::array<u8*, num_pages> write_pages; /* halfword and word writes */
+	std::array<u8*, num_pages> byte_write_pages; /* VRAM ignores byte writes */
+
+	/* With fastmem enabled, the WRAMs live in shared memory that is also mapped into the arena */
+	std::array<u8, 0x40000> board_wram_storage;
+	std::array<u8, 0x8000> chip_wram_storage;
+	std::span<u8, 0x40000> board_wram = board_wram_storage;
+	std::span<u8, 0x8000> chip_wram = chip_wram_storage;
+
+	/* Fastmem: a 4 GiB host address range in which host address 'fastmem_arena + addr' holds the byte at GBA address 'addr',
+	   for BIOS, WRAM (with mirrors) and ROM (with mirrors; read-only). Everything else is left PROT_NONE, so that accesses
+	   to I/O, unmapped memory, the EEPROM, and writes to read-only memory fault, and are made through Read/Write by the fault handler.
+	   WRAM stores that do not fault skip the block invalidation in Write; whoever makes them must call CPU::InvalidateBlocks. */
+	constexpr u64 fastmem_arena_size = u64(1) << 32;
+	constexpr size_t fastmem_wram_size = 0x40000 + 0x8000;
+
+	u8* fastmem_arena;
+	int fastmem_wram_fd = -1;
+	int fastmem_bios_fd = -1;
 
-	std::array<u8, 0x40000> board_wram;
-	std::array<u8, 0x8000> chip_wram;
+	void MapFastmemReadOnly(int& fd, const u8* data, size_t size, u32 region_start, u32 region_size);
+	void MapFastmemRom();
+	void MapFastmemView(int fd, size_t offset, size_t size, u32 region_start, u32 region_size, int prot);
+	void UpdateFastmemReadOnlyRegions();
 }
\ No newline at end of file
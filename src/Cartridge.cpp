@@ -1,33 +1,122 @@
+module;
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 module Cartridge;
 
+import Bus;
+
 namespace Cartridge
 {
+	int GetRomFileDescriptor()
+	{
+		return rom_fd;
+	}
+
+
+	size_t GetRomFileSize()
+	{
+		return rom_file_size;
+	}
+
+
+	const u8* GetRomPointer(u32 addr)
+	{
+		return rom_ptr + (addr & 0x1FF'FFFF & rom_size_mask);
+	}
+
+
+	u32 GetRomSize()
+	{
+		return u32(rom_size);
+	}
+
+
 	void Initialize()
 	{
-		sram.resize(0x10000, 0xFF); /* TODO: for now, SRAM is assumed to always exist and be 64 KiB */
-		sram_size_mask = 0xFFFF;
+		if (!save_ptr) {
+			SetUnbackedSave(SaveType::None);
+		}
+		save_flush_pending = false;
+		ResetEeprom();
+		ResetFlash();
 	}
 
 
 	bool LoadRom(const std::string& path)
 	{
-		auto optional_vec = ReadFileIntoVector(path);
-		if (optional_vec) {
-			rom = optional_vec.value();
+		if (!MapRomFile(path)) {
+			auto optional_vec = ReadFileIntoVector(path);
+			if (!optional_vec) {
+				return false;
+			}
+			UnmapRomFile();
+			rom = std::move(optional_vec.value());
 			ResizeRomToPowerOfTwo(rom);
-			rom_size_mask = uint(rom.size() - 1);
-			return true;
+			rom_ptr = rom.data();
+			rom_size = rom.size();
 		}
-		else {
-			return false;
+		rom_size_mask = uint(rom_size - 1);
+		CloseSaveFile();
+		if (SaveType detected_save_type = DetectSaveType(); detected_save_type != SaveType::None) {
+			save_type = detected_save_type;
+			OpenSaveFile(std::filesystem::path(path).replace_extension(".sav"));
 		}
+		ResetEeprom();
+		ResetFlash();
+		Bus::RebuildPageTables(); /* after the save type is known, as the EEPROM takes over ROM pages */
+		return true;
 	}
 
 
-	u8 ReadSram(u32 addr)
+	bool MapRomFile(const std::string& path)
 	{
-		u32 offset = addr & sram_size_mask; /* todo: detect sram size */
-		return sram[offset];
+#ifdef __linux__
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+			close(fd);
+			return false;
+		}
+		size_t file_size = size_t(file_stat.st_size);
+		size_t mapping_size = std::bit_ceil(file_size);
+		size_t mirror_size = mapping_size - file_size;
+		if (mirror_size > 0 && file_size % sysconf(_SC_PAGESIZE) != 0) {
+			/* The mirror could not start on a page boundary */
+			close(fd);
+			return false;
+		}
+		void* mapping = mmap(nullptr, mapping_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		bool success = mapping != MAP_FAILED
+			&& mmap(mapping, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED
+			&& (mirror_size == 0 || mmap(static_cast<u8*>(mapping) + file_size, mirror_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED);
+		if (!success) {
+			if (mapping != MAP_FAILED) {
+				munmap(mapping, mapping_size);
+			}
+			close(fd);
+			return false;
+		}
+		UnmapRomFile();
+		rom.clear();
+		rom.shrink_to_fit();
+		rom_fd = fd;
+		rom_file_size = file_size;
+		rom_mapping = static_cast<u8*>(mapping);
+		rom_ptr = rom_mapping;
+		rom_size = mapping_size;
+		return true;
+#else
+		return false;
+#endif
 	}
 
 
@@ -36,7 +125,7 @@ namespace Cartridge
 	{
 		u32 offset = addr & 0x1FF'FFFF & rom_size_mask;
 		Int ret;
-		std::memcpy(&ret, rom.data() + offset, sizeof(Int));
+		std::memcpy(&ret, rom_ptr + offset, sizeof(Int));
 		return ret;
 	}
 
@@ -53,10 +142,16 @@ namespace Cartridge
 	}
 
 
-	void WriteSram(u32 addr, u8 data)
+	void UnmapRomFile()
 	{
-		u32 offset = addr & sram_size_mask;
-		sram[offset] = data;
+#ifdef __linux__
+		if (rom_mapping) {
+			munmap(rom_mapping, rom_size);
+			close(rom_fd);
+			rom_mapping = nullptr;
+			rom_fd = -1;
+		}
+#endif
 	}
 
 
@@ -3,29 +3,166 @@ export module Cartridge;
 import Util;
 
 import <algorithm>;
+import <array>;
 import <bit>;
 import <cassert>;
 import <concepts>;
 import <cstring>;
+import <filesystem>;
 import <string>;
+import <string_view>;
+import <thread>;
+import <utility>;
 import <vector>;
 
 namespace Cartridge
 {
 	export
 	{
+		enum class SaveType {
+			None, Sram, Eeprom512, Eeprom8K, Flash64K, Flash128K
+		};
+
+		enum class FlashChip {
+			Atmel, Macronix64K, Macronix128K, Panasonic, Sanyo, Sst
+		};
+
+		void CloseSaveFile();
+		int GetRomFileDescriptor();
+		size_t GetRomFileSize();
+		const u8* GetRomPointer(u32 addr);
+		u32 GetRomSize();
+		SaveType GetSaveType();
 		void Initialize();
+		bool IsEepromAddress(u32 addr);
 		bool LoadRom(const std::string& path);
+		u16 ReadEeprom();
+		void ReadEepromStream(u8* dst, uint count);
 		u8 ReadSram(u32 addr);
 		template<std::integral Int> Int ReadRom(u32 addr);
+		void WriteEeprom(u16 data);
+		void WriteEepromStream(const u8* src, uint count);
+		void SetFlashChip(FlashChip chip);
 		void WriteSram(u32 addr, u8 data);
 	}
 
+	SaveType DetectSaveType();
+	bool MapRomFile(const std::string& path);
+	void NotifySaveWritten();
+	void OnFlashReady(u64);
+	void OnSaveFlushEvent(u64);
+	void OpenSaveFile(const std::filesystem::path& path);
+	void ReadEepromBlock(u32 block);
+	u8 ReadFlash(u32 addr);
+	void ResetEeprom();
+	void ResetFlash();
 	void ResizeRomToPowerOfTwo(std::vector<u8>& rom);
+	void SetUnbackedSave(SaveType type);
+	void ShrinkEepromSave();
+	void StartFlashOperation(u64 busy_cycles);
+	size_t SaveTypeToSize(SaveType type);
+	void UnmapRomFile();
+	void WriteEepromBlock(u32 block);
+	void WriteFlash(u32 addr, u8 data);
+
+	/* ID strings that the official libraries put in the ROM, at word-aligned addresses. The EEPROM size is not part of the string. */
+	constexpr std::array<std::pair<std::string_view, SaveType>, 6> save_type_ids = {{
+		{ "EEPROM_V", SaveType::Eeprom8K },
+		{ "SRAM_F_V", SaveType::Sram },
+		{ "SRAM_V", SaveType::Sram },
+		{ "FLASH1M_V", SaveType::Flash128K },
+		{ "FLASH512_V", SaveType::Flash64K },
+		{ "FLASH_V", SaveType::Flash64K }
+	}};
+
+	/* Saves are flushed once the game has not written to them for this many cycles (about a second) */
+	constexpr u64 save_flush_delay = 1 << 24;
 
 	u32 rom_size_mask;
-	u32 sram_size_mask;
 
-	std::vector<u8> rom;
-	std::vector<u8> sram;
-}
\ No newline at end of file
+	/* The ROM, padded to a power of two by mirroring its beginning. Where possible, the file is mapped read-only rather than read:
+	   once over the start of a reserved range, and once more (from its beginning) over the remainder, so that nothing is copied
+	   and the pages are shared with the page cache. */
+	const u8* rom_ptr;
+	size_t rom_size;
+	u8* rom_mapping; /* start of the mapped range, if the file is mapped */
+	int rom_fd = -1; /* kept open while the file is mapped, so that fastmem can map it too */
+	size_t rom_file_size;
+
+	std::vector<u8> rom; /* holds the ROM if the file could not be mapped */
+
+	/* Save memory. For detected save types, it is a shared mapping of the .sav file next to the ROM, so that writes are
+	   plain stores; the kernel is asked to start writing the pages back (without waiting for it) when the game stops writing.
+	   Closing the file waits for the write-back, which is done on a thread of its own to keep it off the emulation thread. */
+	SaveType save_type;
+	u8* save_ptr;
+	size_t save_size;
+	u32 save_size_mask;
+	u8* save_mapping; /* equal to 'save_ptr' if the save is backed by a file */
+	int save_fd = -1; /* the file of 'save_mapping' */
+	u64 last_save_write_time;
+	bool save_flush_pending;
+
+	std::vector<u8> save_buffer; /* holds the save if it is not backed by a file */
+	std::jthread save_close_thread; /* syncs, unmaps and closes the last save file that was closed */
+
+	/* EEPROM, accessed serially through bit 0 of halfwords in the upper ROM area. A command is "11" (read) or "10" (write),
+	   followed by a block address of 6 (512 B) or 14 (8 KiB; only the low 10 bits are used) bits, the 64 data bits of a write,
+	   and a stop bit. A read response is 4 dummy bits followed by the 64 data bits. Bits are sent most significant first. */
+	enum class EepromState {
+		ReceivingCommand, SendingData
+	};
+
+	constexpr uint eeprom_response_length = 4 + 64;
+
+	struct Eeprom {
+		EepromState state;
+		uint address_bits; /* 6 or 14; taken from the length of the first command sent by DMA */
+		uint bits_received;
+		uint bits_sent;
+		uint command;
+		u32 block;
+		u64 data;
+		u32 start_addr; /* 0xFFFF'FFFF if there is no EEPROM */
+	} eeprom;
+
+	/* Flash, programmed through command sequences: AA to 5555 and 55 to 2AAA, followed by a command byte to 5555.
+	   Chips of 128 KiB are accessed through two 64 KiB banks. Erases and writes take effect at once, but the chip reports
+	   itself busy (bit 7 of reads inverted, for data polling) until an event fires. */
+	enum class FlashPendingWrite {
+		None, Program, AtmelPage, BankSwitch
+	};
+
+	struct FlashChipId {
+		u8 manufacturer, device;
+	};
+
+	constexpr std::array<FlashChipId, 6> flash_chip_ids = {{
+		{ 0x1F, 0x3D }, /* Atmel AT29LV512 (64 KiB) */
+		{ 0xC2, 0x1C }, /* Macronix MX29L512 (64 KiB) */
+		{ 0xC2, 0x09 }, /* Macronix MX29L010 (128 KiB) */
+		{ 0x32, 0x1B }, /* Panasonic MN63F805MNP (64 KiB) */
+		{ 0x62, 0x13 }, /* Sanyo LE26FV10N1TS (128 KiB) */
+		{ 0xBF, 0xD4 } /* SST 39VF512 (64 KiB) */
+	}};
+
+	/* Busy times, in cycles; well below the data sheet maxima, as games poll with timeouts */
+	constexpr u64 flash_program_cycles = 650;
+	constexpr u64 flash_sector_erase_cycles = 30000;
+	constexpr u64 flash_chip_erase_cycles = 60000;
+	constexpr u64 flash_atmel_page_write_cycles = 10000;
+
+	constexpr uint flash_atmel_page_size = 128;
+
+	struct Flash {
+		FlashChip chip;
+		FlashPendingWrite pending_write;
+		uint unlock_step; /* 0: expecting AA to 5555, 1: expecting 55 to 2AAA, 2: expecting a command */
+		uint atmel_bytes_left;
+		u32 atmel_page_offset;
+		u32 bank_offset;
+		bool busy;
+		bool erase_armed;
+		bool id_mode;
+	} flash;
+}
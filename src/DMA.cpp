@@ -1,6 +1,7 @@
 module DMA;
 
 import Bus;
+import Cartridge;
 import CPU;
 import Debug;
 
@@ -26,10 +27,6 @@ namespace DMA
 		dma_ch[1].perform_dma_func = PerformDma<1>;
 		dma_ch[2].perform_dma_func = PerformDma<2>;
 		dma_ch[3].perform_dma_func = PerformDma<3>;
-		dma_ch[0].suspend_dma_func = SuspendDma<0>;
-		dma_ch[1].suspend_dma_func = SuspendDma<1>;
-		dma_ch[2].suspend_dma_func = SuspendDma<2>;
-		dma_ch[3].suspend_dma_func = SuspendDma<3>;
 		dma_ch[0].irq_source = IRQ::Source::Dma0;
 		dma_ch[1].irq_source = IRQ::Source::Dma1;
 		dma_ch[2].irq_source = IRQ::Source::Dma2;
@@ -61,10 +58,10 @@ namespace DMA
 
 	/* A free function (not part of DmaChannel struct), so that it works correctly with the scheduler
 	   (it stores a pointer to this function, and cannot store member function pointers).
-	   Templated, because the scheduler expects a function of the form u64 f(u64).
+	   Templated, because the scheduler expects a function of the form u64 f().
 	   TODO: maybe address? Could use std::function and bind 'this', but it has some overhead */
 	template<uint dma_index> 
-	u64 PerformDma(u64 max_cycles_to_run)
+	u64 PerformDma()
 	{
 		static_assert(dma_index <= 3);
 		DmaChannel& dma = dma_ch[dma_index];
@@ -102,8 +99,11 @@ namespace DMA
 		}
 
 		dma.cycle = 0;
+		if constexpr (dma_index == 3) {
+			PerformEepromDma(dma); /* leaves nothing for the loop below if it takes care of the transfer */
+		}
 		auto DoDma = [&] <std::integral Int> {
-			while (dma.current_count > 0 && dma.cycle < max_cycles_to_run) {
+			while (dma.current_count > 0 && dma.cycle < Scheduler::next_deadline) {
 				Bus::Write<Int, driver>(dma.current_dst_addr, Bus::Read<Int, driver>(dma.current_src_addr));
 				--dma.current_count;
 				dma.current_dst_addr += dma.dst_addr_incr;
@@ -131,10 +131,50 @@ namespace DMA
 				dma.control.enable = false;
 			}
 		}
+		else {
+			dma.suspended = true; /* stopped at the deadline; the transfer is resumed on the next run */
+		}
 		return dma.cycle;
 	}
 
 
+	void PerformEepromDma(DmaChannel& dma)
+	{
+		/* Games talk to the EEPROM one bit per halfword, letting DMA3 transfer a whole command or response at a time.
+		   Such a transfer between the EEPROM and WRAM is handed to the EEPROM as one stream, rather than going through the bus bit by bit. */
+		constexpr u32 max_eeprom_transfer_count = 2 + 14 + 64 + 1;
+		if (dma.control.transfer_type != 0 || dma.control.repeat || dma.current_count > max_eeprom_transfer_count) {
+			return;
+		}
+		bool to_eeprom = Cartridge::IsEepromAddress(dma.current_dst_addr);
+		if (!to_eeprom && !Cartridge::IsEepromAddress(dma.current_src_addr)) {
+			return;
+		}
+		u32 eeprom_addr = to_eeprom ? dma.current_dst_addr : dma.current_src_addr;
+		u32 wram_addr = to_eeprom ? dma.current_src_addr : dma.current_dst_addr;
+		u32 wram_addr_incr = to_eeprom ? dma.src_addr_incr : dma.dst_addr_incr;
+		u32 size = 2 * dma.current_count;
+		u8* host_ptr = Bus::GetHostPointer(wram_addr);
+		if (wram_addr >> 25 != 1 || wram_addr_incr != 2 || Bus::GetHostPointer(wram_addr + size - 2) != host_ptr + size - 2) {
+			return;
+		}
+
+		if (to_eeprom) {
+			Cartridge::WriteEepromStream(host_ptr, dma.current_count);
+		}
+		else {
+			Cartridge::ReadEepromStream(host_ptr, dma.current_count);
+			CPU::InvalidateBlocks(wram_addr);
+			CPU::InvalidateBlocks(wram_addr + size - 2);
+		}
+		/* The reads and writes of a DMA alternate, so that every access is non-sequential */
+		dma.cycle += dma.current_count * (Bus::GetAccessCycles<u16>(wram_addr, false) + Bus::GetAccessCycles<u16>(eeprom_addr, false));
+		dma.current_dst_addr += dma.current_count * dma.dst_addr_incr;
+		dma.current_src_addr += dma.current_count * dma.src_addr_incr;
+		dma.current_count = 0;
+	}
+
+
 	template<std::integral Int>
 	Int ReadReg(u32 addr)
 	{
@@ -191,13 +231,6 @@ namespace DMA
 		}
 	}
 
-	template<uint dma_index>
-	void SuspendDma()
-	{
-		dma_ch[dma_index].suspended = true;
-	}
-
-
 	template<std::integral Int>
 	void WriteReg(u32 addr, Int data)
 	{
@@ -332,7 +365,7 @@ namespace DMA
 
 	void DmaChannel::NotifyDmaActive() const
 	{
-		Scheduler::EngageDriver(driver_type, perform_dma_func, suspend_dma_func);
+		Scheduler::EngageDriver(driver_type, perform_dma_func);
 	}
 
 
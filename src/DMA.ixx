@@ -62,11 +62,10 @@ namespace DMA
 		IRQ::Source irq_source;
 		Scheduler::DriverType driver_type;
 		Scheduler::DriverRunFunc perform_dma_func;
-		Scheduler::DriverSuspendFunc suspend_dma_func;
 	};
 
-	template<uint dma_index> u64 PerformDma(u64 max_cycles_to_run);
-	template<uint dma_index> void SuspendDma();
+	template<uint dma_index> u64 PerformDma();
+	void PerformEepromDma(DmaChannel& dma);
 
 	std::array<DmaChannel, 4> dma_ch;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+module Cartridge;
+
+namespace Cartridge
+{
+	bool IsEepromAddress(u32 addr)
+	{
+		return addr >= eeprom.start_addr && addr <= 0x0DFF'FFFF;
+	}
+
+
+	u16 ReadEeprom()
+	{
+		if (eeprom.state != EepromState::SendingData) {
+			return 1; /* ready; writes complete instantly */
+		}
+		uint bit_index = eeprom.bits_sent++;
+		if (eeprom.bits_sent == eeprom_response_length) {
+			eeprom.state = EepromState::ReceivingCommand;
+		}
+		return bit_index < 4 ? 0 : eeprom.data >> (eeprom_response_length - 1 - bit_index) & 1;
+	}
+
+
+	void ReadEepromBlock(u32 block)
+	{
+		u32 offset = block * 8 & u32(save_size - 1);
+		eeprom.data = 0;
+		for (uint i = 0; i < 8; ++i) {
+			eeprom.data = eeprom.data << 8 | save_ptr[offset + i];
+		}
+		eeprom.state = EepromState::SendingData;
+		eeprom.bits_sent = 0;
+	}
+
+
+	void ReadEepromStream(u8* dst, uint count)
+	{
+		for (uint i = 0; i < count; ++i) {
+			u16 bit = ReadEeprom();
+			std::memcpy(dst + 2 * i, &bit, sizeof(u16));
+		}
+	}
+
+
+	void ResetEeprom()
+	{
+		bool has_eeprom = save_type == SaveType::Eeprom512 || save_type == SaveType::Eeprom8K;
+		eeprom = {};
+		eeprom.state = EepromState::ReceivingCommand;
+		eeprom.address_bits = save_type == SaveType::Eeprom512 ? 6 : 14;
+		/* With ROMs larger than 16 MiB, only the last 256 bytes of the region are the EEPROM */
+		eeprom.start_addr = !has_eeprom ? 0xFFFF'FFFF : rom_size > 0x100'0000 ? 0x0DFF'FF00 : 0x0D00'0000;
+	}
+
+
+	void WriteEeprom(u16 data)
+	{
+		uint bit = data & 1;
+		eeprom.state = EepromState::ReceivingCommand; /* sending a command aborts a pending response */
+		uint index = eeprom.bits_received++;
+		if (index == 0) {
+			if (bit == 0) { /* commands start with a 1 */
+				eeprom.bits_received = 0;
+			}
+			eeprom.command = bit;
+			eeprom.block = 0;
+			eeprom.data = 0;
+		}
+		else if (index == 1) {
+			eeprom.command = eeprom.command << 1 | bit;
+		}
+		else if (index < 2 + eeprom.address_bits) {
+			eeprom.block = eeprom.block << 1 | bit;
+		}
+		else if (eeprom.command == 3) { /* stop bit of a read */
+			eeprom.bits_received = 0;
+			ReadEepromBlock(eeprom.block);
+		}
+		else if (index < 2 + eeprom.address_bits + 64) {
+			eeprom.data = eeprom.data << 1 | bit;
+		}
+		else { /* stop bit of a write */
+			eeprom.bits_received = 0;
+			WriteEepromBlock(eeprom.block);
+		}
+	}
+
+
+	void WriteEepromBlock(u32 block)
+	{
+		u32 offset = block * 8 & u32(save_size - 1);
+		for (uint i = 0; i < 8; ++i) {
+			save_ptr[offset + i] = u8(eeprom.data >> (56 - 8 * i));
+		}
+		eeprom.state = EepromState::ReceivingCommand;
+		NotifySaveWritten();
+	}
+
+
+	void WriteEepromStream(const u8* src, uint count)
+	{
+		auto Bit = [src](uint index) {
+			u16 halfword;
+			std::memcpy(&halfword, src + 2 * index, sizeof(u16));
+			return halfword & 1u;
+		};
+		auto Bits = [&](uint start, uint num) {
+			u64 value = 0;
+			for (uint i = 0; i < num; ++i) {
+				value = value << 1 | Bit(start + i);
+			}
+			return value;
+		};
+		/* Decode a whole command at once. Its length also tells the address width, which cannot be known otherwise. */
+		if (eeprom.bits_received == 0 && count > 2 && Bit(0) == 1) {
+			bool read = Bit(1) == 1;
+			for (uint address_bits : { 6u, 14u }) {
+				if (count == 2 + address_bits + (read ? 0 : 64) + 1) {
+					eeprom.address_bits = address_bits;
+					if (address_bits == 6 && save_type == SaveType::Eeprom8K) {
+						ShrinkEepromSave();
+					}
+					u32 block = u32(Bits(2, address_bits));
+					if (read) {
+						ReadEepromBlock(block);
+					}
+					else {
+						eeprom.data = Bits(2 + address_bits, 64);
+						WriteEepromBlock(block);
+					}
+					return;
+				}
+			}
+		}
+		for (uint i = 0; i < count; ++i) {
+			WriteEeprom(u16(Bit(i)));
+		}
+	}
+}
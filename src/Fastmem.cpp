@@ -0,0 +1,343 @@
+module;
+
+#ifdef __linux__
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+module Bus;
+
+import Bios;
+import Cartridge;
+import UserMessage;
+
+/* Optional mapping of the GBA address space into a 4 GiB host range, so that code with an address in hand can access
+   memory with one host load or store at 'fastmem_arena + addr'. The WRAMs are moved into a memfd, which is mapped once
+   for the regular Bus code and once per mirror into the arena. The BIOS is copied into a memfd of its own, and the ROM file
+   is mapped directly, both read-only. Accesses that should go through handlers instead (I/O, open bus, writes to read-only memory) fault.
+   The fault handler decodes the faulting instruction, performs the access with Bus::Read/Write, and resumes after it.
+   Stores that do not fault bypass Bus::Write, so code storing to WRAM through the arena must call CPU::InvalidateBlocks itself. */
+
+namespace Bus
+{
+#if defined(__linux__) && defined(__x86_64__)
+	/* Context slots of the registers numbered as in x86-64 instruction encodings */
+	constexpr std::array<int, 16> host_reg_context_index = {
+		REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+		REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15
+	};
+
+	struct sigaction prev_sigsegv_action;
+	struct sigaction prev_sigbus_action;
+
+	/* Emulates the load or store at the instruction pointer of 'regs' on the guest address it accesses in the arena.
+	   Handles the forms of MOV, MOVZX and MOVSX that access 1, 2 or 4 bytes, and returns false for anything else. */
+	bool EmulateFastmemAccess(greg_t* regs)
+	{
+		const u8* code = reinterpret_cast<const u8*>(regs[REG_RIP]);
+		const u8* p = code;
+		bool operand_size_prefix = false;
+		u8 rex = 0;
+		if (*p == 0x66) {
+			operand_size_prefix = true;
+			++p;
+		}
+		if ((*p & 0xF0) == 0x40) {
+			rex = *p++;
+		}
+		if (rex & 8) {
+			return false; /* 64-bit operand */
+		}
+		enum class Op { Load, LoadZeroExtend, LoadSignExtend, Store, StoreImm } op;
+		uint size;
+		u8 opcode = *p++;
+		switch (opcode) {
+		case 0x88: op = Op::Store; size = 1; break;
+		case 0x89: op = Op::Store; size = operand_size_prefix ? 2 : 4; break;
+		case 0x8A: op = Op::Load; size = 1; break;
+		case 0x8B: op = Op::Load; size = operand_size_prefix ? 2 : 4; break;
+		case 0xC6: op = Op::StoreImm; size = 1; break;
+		case 0xC7: op = Op::StoreImm; size = operand_size_prefix ? 2 : 4; break;
+		case 0x0F:
+			if (operand_size_prefix) {
+				return false; /* extension into a 16-bit register */
+			}
+			switch (*p++) {
+			case 0xB6: op = Op::LoadZeroExtend; size = 1; break;
+			case 0xB7: op = Op::LoadZeroExtend; size = 2; break;
+			case 0xBE: op = Op::LoadSignExtend; size = 1; break;
+			case 0xBF: op = Op::LoadSignExtend; size = 2; break;
+			default: return false;
+			}
+			break;
+		default:
+			return false;
+		}
+
+		/* Effective address from the ModRM byte, and the SIB byte and displacement following it */
+		u8 modrm = *p++;
+		uint mod = modrm >> 6;
+		uint reg = (modrm >> 3 & 7) | (rex & 4) << 1;
+		uint rm = modrm & 7;
+		if (mod == 3 || op == Op::StoreImm && (modrm >> 3 & 7) != 0) {
+			return false;
+		}
+		u64 ea;
+		bool rip_relative = false;
+		if (rm == 4) {
+			u8 sib = *p++;
+			uint index = (sib >> 3 & 7) | (rex & 2) << 2;
+			uint base = (sib & 7) | (rex & 1) << 3;
+			ea = index == 4 ? 0 : u64(regs[host_reg_context_index[index]]) << (sib >> 6);
+			if (mod == 0 && (base & 7) == 5) {
+				ea += s64(s32(p[0] | p[1] << 8 | p[2] << 16 | u32(p[3]) << 24));
+				p += 4;
+			}
+			else {
+				ea += regs[host_reg_context_index[base]];
+			}
+		}
+		else if (mod == 0 && rm == 5) {
+			rip_relative = true;
+			ea = s64(s32(p[0] | p[1] << 8 | p[2] << 16 | u32(p[3]) << 24));
+			p += 4;
+		}
+		else {
+			ea = regs[host_reg_context_index[rm | (rex & 1) << 3]];
+		}
+		if (mod == 1) {
+			ea += s64(s8(*p++));
+		}
+		else if (mod == 2) {
+			ea += s64(s32(p[0] | p[1] << 8 | p[2] << 16 | u32(p[3]) << 24));
+			p += 4;
+		}
+		u32 imm = 0;
+		if (op == Op::StoreImm) {
+			for (uint i = 0; i < size; ++i) {
+				imm |= u32(*p++) << 8 * i;
+			}
+		}
+		if (rip_relative) {
+			ea += u64(p - code) + regs[REG_RIP];
+		}
+		if (ea - u64(fastmem_arena) >= fastmem_arena_size) {
+			return false;
+		}
+		u32 addr = u32(ea - u64(fastmem_arena));
+
+		/* Without a REX prefix, byte registers 4-7 are AH, CH, DH and BH */
+		bool high_byte = size == 1 && rex == 0 && (op == Op::Load || op == Op::Store) && reg >= 4;
+		greg_t& reg_value = regs[host_reg_context_index[high_byte ? reg - 4 : reg]];
+		uint byte_shift = high_byte ? 8 : 0;
+		if (op == Op::Store || op == Op::StoreImm) {
+			u32 data = op == Op::StoreImm ? imm : u32(u64(reg_value) >> byte_shift);
+			switch (size) {
+			case 1: Write<u8>(addr, u8(data)); break;
+			case 2: Write<u16>(addr, u16(data)); break;
+			default: Write<u32>(addr, data); break;
+			}
+		}
+		else {
+			u32 data;
+			switch (size) {
+			case 1: data = op == Op::LoadSignExtend ? u32(s8(Read<u8>(addr))) : Read<u8>(addr); break;
+			case 2: data = op == Op::LoadSignExtend ? u32(s16(Read<u16>(addr))) : Read<u16>(addr); break;
+			default: data = Read<u32>(addr); break;
+			}
+			if (op == Op::Load && size < 4) {
+				/* Byte and halfword loads leave the rest of the register as is */
+				u64 mask = ((u64(1) << 8 * size) - 1) << byte_shift;
+				reg_value = greg_t(u64(reg_value) & ~mask | u64(data) << byte_shift & mask);
+			}
+			else {
+				reg_value = greg_t(data); /* 32-bit results clear the upper half */
+			}
+		}
+		regs[REG_RIP] += greg_t(p - code);
+		return true;
+	}
+
+
+	void HandleFastmemFault(int sig, siginfo_t* info, void* context)
+	{
+		u8* fault_addr = static_cast<u8*>(info->si_addr);
+		if (fastmem_arena && fault_addr >= fastmem_arena && fault_addr < fastmem_arena + fastmem_arena_size
+			&& EmulateFastmemAccess(static_cast<ucontext_t*>(context)->uc_mcontext.gregs)) {
+			return;
+		}
+		/* Not an access this handler can make: pass it on to the handler installed before, or restore it and let the
+		   instruction fault again, to be handled as if fastmem had never been enabled */
+		const struct sigaction& prev_action = sig == SIGSEGV ? prev_sigsegv_action : prev_sigbus_action;
+		if (prev_action.sa_flags & SA_SIGINFO) {
+			prev_action.sa_sigaction(sig, info, context);
+		}
+		else if (prev_action.sa_handler != SIG_DFL && prev_action.sa_handler != SIG_IGN) {
+			prev_action.sa_handler(sig);
+		}
+		else {
+			sigaction(sig, &prev_action, nullptr);
+		}
+	}
+
+
+	bool InstallFastmemFaultHandler()
+	{
+		struct sigaction action {};
+		action.sa_sigaction = HandleFastmemFault;
+		action.sa_flags = SA_SIGINFO;
+		sigemptyset(&action.sa_mask);
+		if (sigaction(SIGSEGV, &action, &prev_sigsegv_action) != 0) {
+			return false;
+		}
+		if (sigaction(SIGBUS, &action, &prev_sigbus_action) != 0) {
+			sigaction(SIGSEGV, &prev_sigsegv_action, nullptr);
+			return false;
+		}
+		return true;
+	}
+#endif
+
+
+	bool EnableFastmem()
+	{
+#if defined(__linux__) && defined(__x86_64__)
+		if (fastmem_arena) {
+			return true;
+		}
+		if (!InstallFastmemFaultHandler()) {
+			UserMessage::Show("Failed to install the fault handler for fastmem.", UserMessage::Type::Warning);
+			return false;
+		}
+		void* arena = mmap(nullptr, fastmem_arena_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (arena == MAP_FAILED) {
+			UserMessage::Show("Failed to reserve address space for fastmem.", UserMessage::Type::Warning);
+			return false;
+		}
+		int fd = memfd_create("gba-wram", 0);
+		void* wram = fd >= 0 && ftruncate(fd, fastmem_wram_size) == 0
+			? mmap(nullptr, fastmem_wram_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+			: MAP_FAILED;
+		if (wram == MAP_FAILED) {
+			UserMessage::Show("Failed to allocate shared memory for fastmem.", UserMessage::Type::Warning);
+			if (fd >= 0) close(fd);
+			munmap(arena, fastmem_arena_size);
+			return false;
+		}
+
+		fastmem_arena = static_cast<u8*>(arena);
+		fastmem_wram_fd = fd;
+		u8* wram_ptr = static_cast<u8*>(wram);
+		std::memcpy(wram_ptr, board_wram.data(), board_wram.size());
+		std::memcpy(wram_ptr + board_wram.size(), chip_wram.data(), chip_wram.size());
+		board_wram = std::span<u8, 0x40000>(wram_ptr, 0x40000);
+		chip_wram = std::span<u8, 0x8000>(wram_ptr + 0x40000, 0x8000);
+		MapFastmemView(fastmem_wram_fd, 0, board_wram.size(), 0x0200'0000, 0x100'0000, PROT_READ | PROT_WRITE);
+		MapFastmemView(fastmem_wram_fd, board_wram.size(), chip_wram.size(), 0x0300'0000, 0x100'0000, PROT_READ | PROT_WRITE);
+		RebuildPageTables(); /* also maps BIOS and ROM, and drops the CPU's pointers into the old WRAM */
+		return true;
+#else
+		UserMessage::Show("Fastmem is only available on x86-64 Linux.", UserMessage::Type::Warning);
+		return false;
+#endif
+	}
+
+
+	u8* GetFastmemArena()
+	{
+		return fastmem_arena;
+	}
+
+
+	void MapFastmemReadOnly(int& fd, const u8* data, size_t size, u32 region_start, u32 region_size)
+	{
+#ifdef __linux__
+		/* Drop the previous contents first, so that the region is left PROT_NONE if no new views can be created */
+		mmap(fastmem_arena + region_start, region_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+		if (fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+		if (size == 0 || size % sysconf(_SC_PAGESIZE) != 0) {
+			return;
+		}
+		fd = memfd_create("gba-rom", 0);
+		void* copy = fd >= 0 && ftruncate(fd, size) == 0
+			? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+			: MAP_FAILED;
+		if (copy == MAP_FAILED) {
+			UserMessage::Show("Failed to allocate shared memory for fastmem.", UserMessage::Type::Warning);
+			return;
+		}
+		std::memcpy(copy, data, size);
+		munmap(copy, size);
+		MapFastmemView(fd, 0, size, region_start, region_size, PROT_READ);
+#endif
+	}
+
+
+	void MapFastmemRom()
+	{
+#ifdef __linux__
+		constexpr u32 rom_region_start = 0x0800'0000;
+		constexpr u32 rom_region_size = 0x600'0000;
+		mmap(fastmem_arena + rom_region_start, rom_region_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+		int fd = Cartridge::GetRomFileDescriptor();
+		if (fd < 0) {
+			return; /* the ROM was read rather than mapped; accesses to it take the slow path */
+		}
+		/* Like the mapping in Cartridge: the file, followed by its beginning again up to the next power of two.
+		   The views must start on page boundaries, which requires the file size to be a multiple of the page size.
+		   Cartridge only maps mirrored files for which that holds; ROMs smaller than a page take the slow path. */
+		size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+		size_t rom_size = std::min(Cartridge::GetRomSize(), 0x200'0000u);
+		size_t file_size = std::min(Cartridge::GetRomFileSize(), rom_size);
+		if (file_size % page_size != 0) {
+			return;
+		}
+		for (u32 addr = rom_region_start; addr < rom_region_start + rom_region_size; addr += u32(rom_size)) {
+			u8* view = fastmem_arena + addr;
+			if (mmap(view, file_size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+				|| (file_size < rom_size && mmap(view + file_size, rom_size - file_size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)) {
+				UserMessage::Show("Failed to map memory for fastmem.", UserMessage::Type::Warning);
+				break;
+			}
+		}
+
+		/* Pages with EEPROM addresses go back to PROT_NONE, so that accesses to the EEPROM reach its handlers */
+		u32 eeprom_region_end = rom_region_start + rom_region_size;
+		u32 eeprom_start = eeprom_region_end;
+		while (eeprom_start > 0x0D00'0000 && Cartridge::IsEepromAddress(eeprom_start - 1)) {
+			eeprom_start -= u32(page_size);
+		}
+		if (eeprom_start < eeprom_region_end) {
+			mmap(fastmem_arena + eeprom_start, eeprom_region_end - eeprom_start, PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+		}
+#endif
+	}
+
+
+	void MapFastmemView(int fd, size_t offset, size_t size, u32 region_start, u32 region_size, int prot)
+	{
+#ifdef __linux__
+		/* 'size' divides 'region_size', so the views repeat the memory at its mirrors */
+		for (u32 addr = region_start; addr < region_start + region_size; addr += u32(size)) {
+			if (mmap(fastmem_arena + addr, size, prot, MAP_SHARED | MAP_FIXED, fd, offset) == MAP_FAILED) {
+				/* Remaining mirrors stay PROT_NONE, and accesses to them take the slow path */
+				UserMessage::Show("Failed to map memory for fastmem.", UserMessage::Type::Warning);
+				return;
+			}
+		}
+#endif
+	}
+
+
+	void UpdateFastmemReadOnlyRegions()
+	{
+		MapFastmemReadOnly(fastmem_bios_fd, Bios::GetPointer(0), 0x4000, 0, 0x4000);
+		MapFastmemRom();
+	}
+}
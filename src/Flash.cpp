@@ -0,0 +1,159 @@
+module Cartridge;
+
+import Scheduler;
+
+namespace Cartridge
+{
+	void OnFlashReady(u64)
+	{
+		flash.busy = false;
+	}
+
+
+	u8 ReadFlash(u32 addr)
+	{
+		u32 offset = addr & 0xFFFF;
+		if (flash.id_mode && offset < 2) {
+			FlashChipId id = flash_chip_ids[std::to_underlying(flash.chip)];
+			return offset == 0 ? id.manufacturer : id.device;
+		}
+		u8 data = save_ptr[flash.bank_offset + offset];
+		return flash.busy ? data ^ 0x80 : data;
+	}
+
+
+	void ResetFlash()
+	{
+		if (flash.busy) {
+			Scheduler::RemoveEvent(Scheduler::EventType::FlashReady);
+		}
+		flash = {};
+		flash.chip = save_type == SaveType::Flash128K ? FlashChip::Sanyo : FlashChip::Panasonic;
+	}
+
+
+	void SetFlashChip(FlashChip chip)
+	{
+		/* For games that only work with a particular chip; the default is chosen from the size of the save */
+		flash.chip = chip;
+	}
+
+
+	void StartFlashOperation(u64 busy_cycles)
+	{
+		if (flash.busy) {
+			Scheduler::RemoveEvent(Scheduler::EventType::FlashReady);
+		}
+		flash.busy = true;
+		Scheduler::AddEvent(Scheduler::EventType::FlashReady, busy_cycles, OnFlashReady);
+		NotifySaveWritten();
+	}
+
+
+	void WriteFlash(u32 addr, u8 data)
+	{
+		if (flash.busy && data != 0xF0) {
+			return; /* commands other than reset are ignored until the operation completes */
+		}
+		u32 offset = addr & 0xFFFF;
+		switch (flash.pending_write) {
+		case FlashPendingWrite::Program:
+			/* Programming can only clear bits */
+			save_ptr[flash.bank_offset + offset] &= data;
+			flash.pending_write = FlashPendingWrite::None;
+			StartFlashOperation(flash_program_cycles);
+			return;
+
+		case FlashPendingWrite::AtmelPage:
+			/* Atmel chips are written a page at a time, without erasing first */
+			if (flash.atmel_bytes_left == flash_atmel_page_size) {
+				flash.atmel_page_offset = flash.bank_offset + (offset & ~(flash_atmel_page_size - 1));
+			}
+			save_ptr[flash.atmel_page_offset + (offset & (flash_atmel_page_size - 1))] = data;
+			if (--flash.atmel_bytes_left == 0) {
+				flash.pending_write = FlashPendingWrite::None;
+				StartFlashOperation(flash_atmel_page_write_cycles);
+			}
+			return;
+
+		case FlashPendingWrite::BankSwitch:
+			if (offset == 0) {
+				flash.bank_offset = (data & 1) << 16;
+			}
+			flash.pending_write = FlashPendingWrite::None;
+			return;
+
+		case FlashPendingWrite::None:
+			break;
+
+		default:
+			std::unreachable();
+		}
+
+		switch (flash.unlock_step) {
+		case 0:
+			if (offset == 0x5555 && data == 0xAA) {
+				flash.unlock_step = 1;
+			}
+			else if (data == 0xF0) { /* reset; some chips also accept it without the unlock sequence */
+				flash.id_mode = flash.erase_armed = false;
+			}
+			return;
+
+		case 1:
+			flash.unlock_step = offset == 0x2AAA && data == 0x55 ? 2 : 0;
+			return;
+
+		case 2:
+			flash.unlock_step = 0;
+			if (flash.erase_armed) {
+				flash.erase_armed = false;
+				if (offset == 0x5555 && data == 0x10) {
+					std::memset(save_ptr, 0xFF, save_size);
+					StartFlashOperation(flash_chip_erase_cycles);
+				}
+				else if (data == 0x30) { /* 4 KiB sector containing the address */
+					std::memset(save_ptr + flash.bank_offset + (offset & 0xF000), 0xFF, 0x1000);
+					StartFlashOperation(flash_sector_erase_cycles);
+				}
+				return;
+			}
+			if (offset != 0x5555) {
+				return;
+			}
+			switch (data) {
+			case 0x80:
+				flash.erase_armed = true;
+				break;
+
+			case 0x90:
+				flash.id_mode = true;
+				break;
+
+			case 0xA0:
+				if (flash.chip == FlashChip::Atmel) {
+					flash.pending_write = FlashPendingWrite::AtmelPage;
+					flash.atmel_bytes_left = flash_atmel_page_size;
+				}
+				else {
+					flash.pending_write = FlashPendingWrite::Program;
+				}
+				break;
+
+			case 0xB0:
+				if (save_type == SaveType::Flash128K) {
+					flash.pending_write = FlashPendingWrite::BankSwitch;
+				}
+				break;
+
+			case 0xF0:
+				flash.id_mode = false;
+				break;
+			}
+			return;
+
+		default:
+			std::unreachable();
+		}
+	}
+}
@@ -16,6 +16,7 @@ import Serial;
 import Timers;
 import Util;
 
+import <string>;
 import <string_view>;
 import <vector>;
 
@@ -26,9 +27,39 @@ export struct GBA : Core
 
 	}
 
-	void Detach() override
+	/* Applies a command-line option, given without its leading "--". Returns false if the option is unknown. */
+	bool ApplyOption(std::string_view option)
 	{
+		if (option == "interpreter") {
+			CPU::SetBackend(CPU::Backend::Interpreter);
+		}
+		else if (option == "cached-interpreter") {
+			CPU::SetBackend(CPU::Backend::CachedInterpreter);
+		}
+		else if (option == "jit") {
+			CPU::SetBackend(CPU::Backend::Jit);
+		}
+		else if (option == "hle-bios") {
+			CPU::SetHleBios(true);
+		}
+		else if (option == "fastmem") {
+			Bus::EnableFastmem();
+		}
+		else if (option == "scheduler-stats") {
+			Scheduler::EnableStats("scheduler_stats.txt");
+		}
+		else if (option.starts_with("scheduler-stats=")) {
+			Scheduler::EnableStats(std::string(option.substr(option.find('=') + 1)));
+		}
+		else {
+			return false;
+		}
+		return true;
+	}
 
+	void Detach() override
+	{
+		Cartridge::CloseSaveFile();
 	}
 
 	void DisableAudio() override
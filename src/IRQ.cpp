@@ -7,9 +7,12 @@ namespace IRQ
 {
 	void CheckIrq()
 	{
+		if (IE & IF & 0x3FFF) {
+			CPU::ExitHalt();
+		}
 		irq = IE & IF & 0x3FF;
 		if (ime) {
-			Scheduler::AddEvent(Scheduler::EventType::IrqChange, irq_event_cycle_delay, [] { CPU::SetIRQ(irq); });
+			ScheduleIrqChange(irq);
 		}
 	}
 
@@ -22,6 +25,15 @@ namespace IRQ
 	}
 
 
+	void OnIrqChange(u64 payload)
+	{
+		if (payload & irq_change_pulse) {
+			CPU::SetIRQ(true);
+		}
+		CPU::SetIRQ(payload & irq_change_level);
+	}
+
+
 	void Raise(Source source)
 	{
 		IF |= std::to_underlying(source);
@@ -59,6 +71,23 @@ namespace IRQ
 	}
 
 
+	void ScheduleIrqChange(bool level)
+	{
+		/* Only one change can be pending. A new one is merged into it, so that the pending change still lands on time
+		   however often the IRQ state changes in the meantime, and a raised line does not go unnoticed. */
+		u64 payload = level ? irq_change_level : 0;
+		if (auto pending = Scheduler::GetEventPayload(Scheduler::EventType::IrqChange)) {
+			if (*pending != 0) {
+				payload |= irq_change_pulse;
+			}
+			Scheduler::SetEventPayload(Scheduler::EventType::IrqChange, payload);
+		}
+		else {
+			Scheduler::AddEvent(Scheduler::EventType::IrqChange, irq_event_cycle_delay, OnIrqChange, payload);
+		}
+	}
+
+
 	void StreamState(SerializationStream& stream)
 	{
 
@@ -99,7 +128,7 @@ namespace IRQ
 		bool prev_ime = ime;
 		ime = data & 1;
 		if (ime ^ prev_ime) {
-			Scheduler::AddEvent(Scheduler::EventType::IrqChange, irq_event_cycle_delay, [] { CPU::SetIRQ(ime ? irq : false); });
+			ScheduleIrqChange(ime && irq);
 		}
 	}
 }
\ No newline at end of file
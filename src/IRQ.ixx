@@ -41,9 +41,16 @@ namespace IRQ
 	}
 
 	void CheckIrq();
+	void OnIrqChange(u64 payload);
+	void ScheduleIrqChange(bool level);
 
 	constexpr int irq_event_cycle_delay = 3;
 
+	/* Payload of the IrqChange event: the new level of the CPU's IRQ line, and whether the line was raised by a change
+	   that is superseded before it takes effect, which must still reach the CPU */
+	constexpr u64 irq_change_level = 1;
+	constexpr u64 irq_change_pulse = 2;
+
 	bool ime;
 	bool irq;
 	u16 IE;
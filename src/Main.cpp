@@ -1,22 +1,39 @@
 import Core;
 import Frontend;
 import GBA;
+import UserMessage;
 
+import <format>;
 import <memory>;
+import <string_view>;
+import <vector>;
 
-int main(int argc, char** argv) /* Optional CLI arguments: path to rom, path to bios */
+int main(int argc, char** argv) /* Optional CLI arguments: path to rom, path to bios; options start with "--" and may appear anywhere */
 {
-	std::shared_ptr<Core> core = std::make_shared<GBA>();
+	auto gba = std::make_shared<GBA>();
+	std::shared_ptr<Core> core = gba;
 	if (!Frontend::Initialize(core)) {
 		exit(1);
 	}
+	std::vector<const char*> paths;
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg.starts_with("--")) {
+			if (!gba->ApplyOption(arg.substr(2))) {
+				UserMessage::Show(std::format("Unknown option: {}", arg), UserMessage::Type::Warning);
+			}
+		}
+		else {
+			paths.push_back(argv[i]);
+		}
+	}
 	bool boot_game_immediately = false;
-	if (argc >= 2) {
-		auto rom_path = argv[1];
+	if (paths.size() >= 1) {
+		auto rom_path = paths[0];
 		bool success = Frontend::LoadGame(rom_path);
 		boot_game_immediately = success;
-		if (argc >= 3) {
-			auto bios_path = argv[2];
+		if (paths.size() >= 2) {
+			auto bios_path = paths[1];
 			Frontend::LoadBios(bios_path);
 		}
 	}
@@ -0,0 +1,204 @@
+module;
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+module Cartridge;
+
+import Scheduler;
+import UserMessage;
+
+namespace Cartridge
+{
+	void CloseSaveFile()
+	{
+		if (save_flush_pending) {
+			Scheduler::RemoveEvent(Scheduler::EventType::SaveFlush);
+			save_flush_pending = false;
+		}
+#ifdef __linux__
+		if (save_mapping) {
+			/* Assigning the thread first waits for the previous one, should it still be running */
+			save_close_thread = std::jthread([mapping = save_mapping, size = save_size, fd = save_fd] {
+				msync(mapping, size, MS_SYNC);
+				munmap(mapping, size);
+				close(fd);
+			});
+			save_mapping = nullptr;
+			save_fd = -1;
+		}
+#endif
+		SetUnbackedSave(SaveType::None);
+	}
+
+
+	SaveType DetectSaveType()
+	{
+		constexpr size_t max_id_length = 10;
+		for (size_t offset = 0; offset + max_id_length <= rom_size; offset += 4) {
+			std::string_view str(reinterpret_cast<const char*>(rom_ptr + offset), max_id_length);
+			for (auto [id, type] : save_type_ids) {
+				if (str.starts_with(id)) {
+					return type;
+				}
+			}
+		}
+		return SaveType::None;
+	}
+
+
+	SaveType GetSaveType()
+	{
+		return save_type;
+	}
+
+
+	void NotifySaveWritten()
+	{
+		last_save_write_time = Scheduler::GetGlobalTime();
+		if (save_mapping && !save_flush_pending) {
+			save_flush_pending = true;
+			Scheduler::AddEvent(Scheduler::EventType::SaveFlush, save_flush_delay, OnSaveFlushEvent);
+		}
+	}
+
+
+	void OnSaveFlushEvent(u64)
+	{
+		u64 idle_time = Scheduler::GetGlobalTime() - last_save_write_time;
+		if (idle_time < save_flush_delay) {
+			Scheduler::AddEvent(Scheduler::EventType::SaveFlush, save_flush_delay - idle_time, OnSaveFlushEvent);
+			return;
+		}
+		save_flush_pending = false;
+#ifdef __linux__
+		sync_file_range(save_fd, 0, save_size, SYNC_FILE_RANGE_WRITE); /* only initiates the write-back */
+#endif
+	}
+
+
+	void OpenSaveFile(const std::filesystem::path& path)
+	{
+#ifdef __linux__
+		int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		struct stat file_stat;
+		if (fd < 0 || fstat(fd, &file_stat) != 0) {
+			UserMessage::Show("Could not open the save file; progress will not be saved.", UserMessage::Type::Warning);
+			if (fd >= 0) close(fd);
+			SetUnbackedSave(save_type);
+			return;
+		}
+		size_t file_size = size_t(file_stat.st_size);
+		if (save_type == SaveType::Eeprom8K && file_size == SaveTypeToSize(SaveType::Eeprom512)) {
+			save_type = SaveType::Eeprom512;
+		}
+		size_t size = SaveTypeToSize(save_type);
+		void* mapping = file_size >= size || ftruncate(fd, size) == 0
+			? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+			: MAP_FAILED;
+		if (mapping == MAP_FAILED) {
+			UserMessage::Show("Could not map the save file; progress will not be saved.", UserMessage::Type::Warning);
+			close(fd);
+			SetUnbackedSave(save_type);
+			return;
+		}
+		save_buffer.clear();
+		save_buffer.shrink_to_fit();
+		save_mapping = save_ptr = static_cast<u8*>(mapping);
+		save_fd = fd;
+		save_size = size;
+		save_size_mask = u32(std::min(size, size_t(0x10000)) - 1);
+		if (file_size < size) {
+			std::memset(save_ptr + file_size, 0xFF, size - file_size); /* erased memory */
+		}
+#else
+		SetUnbackedSave(save_type);
+#endif
+	}
+
+
+	u8 ReadSram(u32 addr)
+	{
+		switch (save_type) {
+		case SaveType::Eeprom512: case SaveType::Eeprom8K:
+			return 0xFF; /* the EEPROM is accessed through the ROM area instead */
+
+		case SaveType::Flash64K: case SaveType::Flash128K:
+			return ReadFlash(addr);
+
+		default:
+			return save_ptr[addr & save_size_mask];
+		}
+	}
+
+
+	size_t SaveTypeToSize(SaveType type)
+	{
+		switch (type) {
+		case SaveType::None:      return 0x10000; /* SRAM is still assumed to exist, with the largest size */
+		case SaveType::Sram:      return 0x8000;
+		case SaveType::Eeprom512: return 0x200;
+		case SaveType::Eeprom8K:  return 0x2000;
+		case SaveType::Flash64K:  return 0x10000;
+		case SaveType::Flash128K: return 0x20000;
+		default: std::unreachable();
+		}
+	}
+
+
+	void SetUnbackedSave(SaveType type)
+	{
+		save_type = type;
+		save_buffer.assign(SaveTypeToSize(type), 0xFF);
+		save_ptr = save_buffer.data();
+		save_size = save_buffer.size();
+		save_size_mask = u32(std::min(save_size, size_t(0x10000)) - 1);
+		save_mapping = nullptr;
+	}
+
+
+	void ShrinkEepromSave()
+	{
+		/* The EEPROM turned out to be the 512 B one. The .sav file is cut down to match, so that the size is
+		   recognised the next time, and by other emulators. Blocks 0-63 are at the same offsets with either size. */
+		size_t size = SaveTypeToSize(SaveType::Eeprom512);
+		if (save_mapping) {
+#ifdef __linux__
+			if (mremap(save_mapping, save_size, size, 0) == MAP_FAILED) {
+				return; /* keep using the larger save */
+			}
+			if (ftruncate(save_fd, size) != 0) {
+				UserMessage::Show("Could not shrink the save file to the size of the EEPROM.", UserMessage::Type::Warning);
+			}
+#endif
+		}
+		else {
+			save_buffer.resize(size);
+			save_ptr = save_buffer.data();
+		}
+		save_type = SaveType::Eeprom512;
+		save_size = size;
+		save_size_mask = u32(size - 1);
+	}
+
+
+	void WriteSram(u32 addr, u8 data)
+	{
+		switch (save_type) {
+		case SaveType::Eeprom512: case SaveType::Eeprom8K:
+			break;
+
+		case SaveType::Flash64K: case SaveType::Flash128K:
+			WriteFlash(addr, data);
+			break;
+
+		default:
+			save_ptr[addr & save_size_mask] = data;
+			NotifySaveWritten();
+		}
+	}
+}
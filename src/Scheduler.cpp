@@ -1,65 +1,87 @@
 module Scheduler;
 
 import CPU;
-import Debug;
 import DMA;
 import PPU;
 
 namespace Scheduler
 {
-	void AddEvent(EventType type, u64 time_until_fire, EventCallback callback)
-	{
-		global_time += CPU::GetElapsedCycles();
-		u64 event_absolute_time = global_time + time_until_fire;
-		for (auto it = events.begin(); it != events.end(); ++it) {
-			if (event_absolute_time < it->time) {
-				events.emplace(it, callback, event_absolute_time, type);
-				if (it == events.begin()) {
-					drivers.front().suspend_function();
-				}
-				return;
-			}
+	void AddEvent(EventType type, u64 time_until_fire, EventCallback callback, u64 payload)
+	{
+		u64 event_absolute_time = GetGlobalTime() + time_until_fire;
+		uint index = std::to_underlying(type);
+		events[index] = { callback, payload, event_absolute_time, next_event_order++ };
+		if (event_absolute_time < events[earliest_event].time) {
+			earliest_event = index;
+			next_deadline = std::min(next_deadline, event_absolute_time - global_time);
+		}
+		else if (index == earliest_event) {
+			UpdateEarliestEvent();
 		}
-		events.emplace_back(callback, event_absolute_time, type);
 	}
 
 
 	void ChangeEventTime(EventType type, u64 new_time_to_fire)
 	{
-		for (auto it = events.begin(); it != events.end(); ++it) {
-			if (it->type == type) {
-				EventCallback callback = it->callback;
-				events.erase(it);
-				AddEvent(type, new_time_to_fire, callback);
-				break;
-			}
+		const Event& event = events[std::to_underlying(type)];
+		if (event.time != no_event_time) {
+			AddEvent(type, new_time_to_fire, event.callback, event.payload);
 		}
 	}
 
 
 	void DisengageDriver(DriverType type)
 	{
-		for (auto it = drivers.begin(); it != drivers.end(); ++it) {
-			if (it->type == type) {
-				drivers.erase(it);
-				break;
-			}
+		active_drivers &= ~(1u << GetDriverPriority(type));
+	}
+
+
+	void DumpStats(const std::string& path)
+	{
+		std::ofstream file{ path };
+		if (!file) {
+			return;
+		}
+		file << std::format("{:<16}{:>12}{:>16}{:>14}{:>14}\n", "driver", "runs", "cycles", "cycles/run", "host ms");
+		for (uint i = num_driver_types; i-- > 0; ) {
+			const DriverStats& stats = driver_stats[i];
+			file << std::format("{:<16}{:>12}{:>16}{:>14}{:>14.3f}\n", driver_names[i], stats.runs, stats.cycles,
+				stats.runs ? stats.cycles / stats.runs : 0, stats.host_time / 1e6);
+		}
+		file << std::format("\n{:<16}{:>12}{:>14}{:>14}\n", "event", "callbacks", "ns/callback", "host ms");
+		for (uint i = 0; i < num_event_types; ++i) {
+			const EventStats& stats = event_stats[i];
+			file << std::format("{:<16}{:>12}{:>14}{:>14.3f}\n", event_names[i], stats.callbacks,
+				stats.callbacks ? stats.host_time / stats.callbacks : 0, stats.host_time / 1e6);
 		}
 	}
 
 
-	void EngageDriver(DriverType type, DriverRunFunc run_func, DriverSuspendFunc suspend_func)
+	void EnableStats(const std::string& dump_path)
 	{
-		for (auto it = drivers.begin(); it != drivers.end(); ++it) {
-			if (GetDriverPriority(it->type) < GetDriverPriority(type)) {
-				drivers.emplace(it, type, run_func, suspend_func);
-				if (it == drivers.begin()) {
-					(++it)->suspend_function();
-				}
-				return;
-			}
+		/* Takes effect from the next call to Run. The stats are written to 'dump_path' when the process exits. */
+		if (!stats_enabled) {
+			std::atexit([] { DumpStats(stats_dump_path); });
+		}
+		stats_enabled = true;
+		stats_dump_path = dump_path;
+	}
+
+
+	void EngageDriver(DriverType type, DriverRunFunc run_func)
+	{
+		uint priority = GetDriverPriority(type);
+		drivers[priority] = run_func;
+		if (1u << priority > active_drivers) {
+			next_deadline = 0; /* the running driver hands over to the new one as soon as possible */
 		}
-		drivers.emplace_back(type, run_func, suspend_func);
+		active_drivers |= 1u << priority;
+	}
+
+
+	uint GetActiveDriver()
+	{
+		return 31 - std::countl_zero(active_drivers);
 	}
 
 
@@ -69,49 +91,141 @@ namespace Scheduler
 	}
 
 
+	DriverStats GetDriverStats(DriverType type)
+	{
+		return driver_stats[GetDriverPriority(type)];
+	}
+
+
+	std::optional<u64> GetEventPayload(EventType type)
+	{
+		const Event& event = events[std::to_underlying(type)];
+		if (event.time == no_event_time) {
+			return {};
+		}
+		return event.payload;
+	}
+
+
+	EventStats GetEventStats(EventType type)
+	{
+		return event_stats[std::to_underlying(type)];
+	}
+
+
 	u64 GetGlobalTime()
 	{
 		return global_time + CPU::GetElapsedCycles();
 	}
 
 
+	u64 GetHostTimeSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+
 	void Initialize()
 	{
 		global_time = 0;
-		drivers.clear();
-		events.clear();
+		next_event_order = 0;
+		drivers.fill(nullptr);
+		active_drivers = 0;
+		events.fill({ nullptr, 0, no_event_time, 0 });
+		earliest_event = 0;
+		ResetStats();
 		PPU::AddInitialEvents();
-		EngageDriver(DriverType::Cpu, CPU::Run, CPU::SuspendRun);
+		EngageDriver(DriverType::Cpu, CPU::Run);
 	}
 
 
 	void RemoveEvent(EventType type)
 	{
-		for (auto it = events.begin(); it != events.end(); ) {
-			if (it->type == type) {
-				if (it == events.begin()) {
-					drivers.front().suspend_function();
+		uint index = std::to_underlying(type);
+		if (events[index].time == no_event_time) {
+			return;
+		}
+		events[index].time = no_event_time;
+		if (index == earliest_event) {
+			/* 'next_deadline' is left as is; the running driver merely returns earlier than needed */
+			UpdateEarliestEvent();
+		}
+	}
+
+
+	void ResetStats()
+	{
+		driver_stats = {};
+		event_stats = {};
+	}
+
+
+	void Run()
+	{
+		/* Instantiated twice, so that the timing calls cost nothing unless the stats are wanted */
+		if (stats_enabled) {
+			RunLoop<true>();
+		}
+		else {
+			RunLoop<false>();
+		}
+	}
+
+
+	template<bool collect_stats>
+	void RunLoop()
+	{
+		while (true) {
+			while (global_time < events[earliest_event].time) {
+				next_deadline = events[earliest_event].time - global_time;
+				uint driver = GetActiveDriver();
+				if constexpr (collect_stats) {
+					auto start = std::chrono::steady_clock::now();
+					u64 cycles = drivers[driver]();
+					global_time += cycles;
+					driver_stats[driver].runs++;
+					driver_stats[driver].cycles += cycles;
+					driver_stats[driver].host_time += GetHostTimeSince(start);
+				}
+				else {
+					global_time += drivers[driver]();
 				}
-				events.erase(it);
-				return;
+			}
+			uint event_index = earliest_event;
+			Event& top_event = events[event_index];
+			EventCallback callback = top_event.callback;
+			u64 payload = top_event.payload;
+			global_time = top_event.time; /* just in case we ran for longer than we should have */
+			top_event.time = no_event_time;
+			UpdateEarliestEvent();
+			if constexpr (collect_stats) {
+				auto start = std::chrono::steady_clock::now();
+				callback(payload);
+				event_stats[event_index].callbacks++;
+				event_stats[event_index].host_time += GetHostTimeSince(start);
 			}
 			else {
-				++it;
+				callback(payload);
 			}
 		}
 	}
 
 
-	void Run()
+	void SetEventPayload(EventType type, u64 payload)
 	{
-		while (true) {
-			while (global_time < events.front().time) {
-				global_time += drivers.front().run_function(events.front().time - global_time);
+		/* Leaves the time of the event as is */
+		events[std::to_underlying(type)].payload = payload;
+	}
+
+
+	void UpdateEarliestEvent()
+	{
+		for (uint i = 0; i < num_event_types; ++i) {
+			const Event& event = events[i];
+			const Event& earliest = events[earliest_event];
+			if (event.time < earliest.time || event.time == earliest.time && event.order < earliest.order) {
+				earliest_event = i;
 			}
-			Event top_event = events.front();
-			events.erase(events.begin());
-			global_time = top_event.time; /* just in case we ran for longer than we should have */
-			top_event.callback();
 		}
 	}
 }
\ No newline at end of file
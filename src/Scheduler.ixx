@@ -2,58 +2,120 @@ export module Scheduler;
 
 import Util;
 
+import <array>;
+import <bit>;
+import <chrono>;
+import <cstdlib>;
+import <format>;
+import <fstream>;
+import <limits>;
+import <optional>;
+import <string>;
+import <string_view>;
 import <utility>;
-import <vector>;
 
 namespace Scheduler
 {
 	export
 	{
-		using DriverRunFunc = u64(*)(u64);
-		using DriverSuspendFunc = void(*)();
-		using EventCallback = void(*)();
+		using DriverRunFunc = u64(*)();
+		using EventCallback = void(*)(u64 payload);
 
 		enum class DriverType { /* ordered by priority (low to high) */
 			Cpu, Dma3, Dma2, Dma1, Dma0
 		};
 
 		enum class EventType {
+			FlashReady,
 			HBlank,
 			HBlankSetFlag,
 			IrqChange,
 			NewScanline,
+			SaveFlush,
 			TimerOverflow0,
 			TimerOverflow1,
 			TimerOverflow2,
 			TimerOverflow3
 		};
 
-		void AddEvent(EventType type, u64 time_until_fire, EventCallback callback);
+		/* Collected by Run once enabled with EnableStats, to tell whether the time goes into event callbacks
+		   or into the drivers. Host times are in nanoseconds. */
+		struct DriverStats {
+			u64 runs;
+			u64 cycles;
+			u64 host_time;
+		};
+
+		struct EventStats {
+			u64 callbacks;
+			u64 host_time;
+		};
+
+		void AddEvent(EventType type, u64 time_until_fire, EventCallback callback, u64 payload = 0);
 		void ChangeEventTime(EventType type, u64 new_time_to_fire);
 		void DisengageDriver(DriverType type);
-		void EngageDriver(DriverType type, DriverRunFunc run_func, DriverSuspendFunc suspend_func);
+		void DumpStats(const std::string& path);
+		void EnableStats(const std::string& dump_path);
+		void EngageDriver(DriverType type, DriverRunFunc run_func);
+		DriverStats GetDriverStats(DriverType type);
+		std::optional<u64> GetEventPayload(EventType type);
+		EventStats GetEventStats(EventType type);
 		u64 GetGlobalTime();
 		void Initialize();
 		void RemoveEvent(EventType type);
+		void ResetStats();
 		void Run();
+		void SetEventPayload(EventType type, u64 payload);
+
+		/* Number of cycles after which the running driver must return to the scheduler, counted from the start of its run.
+		   Set to the time until the earliest event before each run, and lowered while the driver runs when an earlier
+		   event is scheduled, or when a driver of higher priority is engaged. */
+		u64 next_deadline;
 	}
 
+	uint GetActiveDriver();
 	uint GetDriverPriority(DriverType type);
+	u64 GetHostTimeSince(std::chrono::steady_clock::time_point start);
+	template<bool collect_stats> void RunLoop();
+	void UpdateEarliestEvent();
 
-	struct Driver {
-		DriverType type;
-		DriverRunFunc run_function;
-		DriverSuspendFunc suspend_function;
-	};
+	constexpr uint num_driver_types = std::to_underlying(DriverType::Dma0) + 1;
+	constexpr uint num_event_types = std::to_underlying(EventType::TimerOverflow3) + 1;
+	constexpr u64 no_event_time = std::numeric_limits<u64>::max();
 
 	struct Event {
 		EventCallback callback;
-		u64 time;
-		EventType type;
+		u64 payload; /* passed to the callback, so that the event carries the value it delivers */
+		u64 time = no_event_time;
+		u64 order; /* breaks ties between events due at the same time, in favour of the one scheduled first */
 	};
 
 	u64 global_time;
+	u64 next_event_order;
 
-	std::vector<Driver> drivers; /* orderer by priority */
-	std::vector<Event> events; /* ordered by timestamp */
+	/* Run functions indexed by priority, and a mask of the engaged drivers with the bit of each driver at its priority.
+	   The driver that runs is the engaged one of highest priority, i.e. the highest bit set. */
+	std::array<DriverRunFunc, num_driver_types> drivers;
+	u32 active_drivers;
+
+	/* One slot per event type, as there is at most one pending event of each type. Scheduling an event of a type
+	   that is already pending reschedules it. The slot of the earliest event is cached, and only looked for again
+	   when that event fires, is removed or is moved back. */
+	std::array<Event, num_event_types> events;
+	uint earliest_event;
+
+	/* Indexed by priority and by event type, respectively */
+	std::array<DriverStats, num_driver_types> driver_stats;
+	std::array<EventStats, num_event_types> event_stats;
+	bool stats_enabled;
+	std::string stats_dump_path;
+
+	constexpr std::array<std::string_view, num_driver_types> driver_names = {
+		"Cpu", "Dma3", "Dma2", "Dma1", "Dma0"
+	};
+
+	constexpr std::array<std::string_view, num_event_types> event_names = {
+		"FlashReady", "HBlank", "HBlankSetFlag", "IrqChange", "NewScanline", "SaveFlush",
+		"TimerOverflow0", "TimerOverflow1", "TimerOverflow2", "TimerOverflow3"
+	};
 }
\ No newline at end of file
@@ -31,7 +31,7 @@ namespace Timers
 
 
 	template<uint timer_id>
-	void OnOverflowWithIrq()
+	void OnOverflowWithIrq(u64)
 	{
 		static_assert(timer_id < 4);
 		Timer& t = timer[timer_id];
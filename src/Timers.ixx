@@ -20,7 +20,7 @@ namespace Timers
 		template<std::integral Int> void WriteReg(u32 addr, Int data);
 	}
 
-	template<uint id> void OnOverflowWithIrq();
+	template<uint id> void OnOverflowWithIrq(u64);
 
 	constexpr std::array prescaler_to_period = { 1, 64, 256, 1024 };
 
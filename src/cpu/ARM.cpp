@@ -97,10 +97,10 @@ namespace CPU
 						StoreReg(r[15]);
 					}
 					if (reg_list & 1 << 14) {
-						StoreReg(r14_usr);
+						StoreReg(banked_r14[BANK_USR]);
 					}
 					if (reg_list & 1 << 13) {
-						StoreReg(r13_usr);
+						StoreReg(banked_r13[BANK_USR]);
 					}
 					for (int i = 12; i >= 8; --i) {
 						if (reg_list & 1 << i) {
@@ -125,10 +125,10 @@ namespace CPU
 						}
 					}
 					if (reg_list & 1 << 13) {
-						StoreReg(r13_usr);
+						StoreReg(banked_r13[BANK_USR]);
 					}
 					if (reg_list & 1 << 14) {
-						StoreReg(r14_usr);
+						StoreReg(banked_r14[BANK_USR]);
 					}
 					if (reg_list & 1 << 15) {
 						StoreReg(r[15]);
@@ -181,7 +181,7 @@ namespace CPU
 						r[15] = LoadReg();
 						FlushPipeline();
 					}
-					cpsr = std::bit_cast<CPSR>(spsr);
+					SetCPSR(spsr);
 				}
 				else {
 					/* Transfer user registers */
@@ -191,10 +191,10 @@ namespace CPU
 							FlushPipeline();
 						}
 						if (reg_list & 1 << 14) {
-							r14_usr = LoadReg();
+							banked_r14[BANK_USR] = LoadReg();
 						}
 						if (reg_list & 1 << 13) {
-							r13_usr = LoadReg();
+							banked_r13[BANK_USR] = LoadReg();
 						}
 						for (int i = 12; i >= 8; --i) {
 							if (reg_list & 1 << i) {
@@ -219,10 +219,10 @@ namespace CPU
 							}
 						}
 						if (reg_list & 1 << 13) {
-							r13_usr = LoadReg();
+							banked_r13[BANK_USR] = LoadReg();
 						}
 						if (reg_list & 1 << 14) {
-							r14_usr = LoadReg();
+							banked_r14[BANK_USR] = LoadReg();
 						}
 						if (reg_list & 1 << 15) {
 							r[15] = LoadReg();
@@ -275,7 +275,7 @@ namespace CPU
 	}
 
 
-	template<ArmDataProcessingInstruction instr>
+	template<ArmDataProcessingInstruction instr, bool reg_or_imm /* 0 = register; 1 = immediate */, bool set_conds>
 	void DataProcessing(u32 opcode) /* ADC, ADD, AND, BIC, CMN, CMP, EOR, MOV, MVN, ORR, RSB, RSC, SBC, SUB, TEQ, TST */
 	{
 		using enum ArmDataProcessingInstruction;
@@ -284,14 +284,14 @@ namespace CPU
 
 		auto rd = opcode >> 12 & 0xF;
 		auto rn = opcode >> 16 & 0xF;
-		bool set_conds = opcode >> 20 & 1;
-		bool reg_or_imm = opcode >> 25 & 1; /* 0 = register; 1 = immediate */
 		u32 op1 = r[rn];
-		if (rn == 15 && reg_or_imm == 0) {
-			op1 += 4;
+		if constexpr (reg_or_imm == 0) {
+			if (rn == 15) {
+				op1 += 4;
+			}
 		}
 		u32 op2 = [&] {
-			if (reg_or_imm == 0) { /* register */
+			if constexpr (reg_or_imm == 0) { /* register */
 				return Shift(opcode, set_conds);
 			}
 			else { /* immediate */
@@ -301,8 +301,8 @@ namespace CPU
 					return imm;
 				}
 				else {
-					if (set_conds) {
-						cpsr.carry = imm >> (rot - 1) & 1;
+					if constexpr (set_conds) {
+						flags.carry = imm >> (rot - 1) & 1;
 					}
 					return std::rotr(imm, rot);
 				}
@@ -310,7 +310,7 @@ namespace CPU
 		}();
 
 		u32 result = [&] {
-			if constexpr (instr == ADC)                 return op1 + op2 + cpsr.carry;
+			if constexpr (instr == ADC)                 return op1 + op2 + flags.carry;
 			if constexpr (instr == ADD || instr == CMN) return op1 + op2;
 			if constexpr (instr == AND || instr == TST) return op1 & op2;
 			if constexpr (instr == BIC)                 return op1 & ~op2;
@@ -320,8 +320,8 @@ namespace CPU
 			if constexpr (instr == MVN)                 return ~op2;
 			if constexpr (instr == ORR)                 return op1 | op2;
 			if constexpr (instr == RSB)                 return op2 - op1;
-			if constexpr (instr == RSC)                 return op2 - op1 + cpsr.carry - 1;
-			if constexpr (instr == SBC)                 return op1 - op2 + cpsr.carry - 1;
+			if constexpr (instr == RSC)                 return op2 - op1 + flags.carry - 1;
+			if constexpr (instr == SBC)                 return op1 - op2 + flags.carry - 1;
 		}();
 
 		if constexpr (!OneOf(instr, CMN, CMP, TEQ, TST)) {
@@ -331,7 +331,7 @@ namespace CPU
 			}
 		}
 
-		if (set_conds) {
+		if constexpr (set_conds) {
 			if (rd == 15) {
 				if (cpsr.mode != cpsr_mode_bits_user && cpsr.mode != cpsr_mode_bits_system) {
 					switch (spsr & 0x1F) {
@@ -345,130 +345,112 @@ namespace CPU
 					default: assert(false); break;
 					}
 					SetExecutionState(static_cast<ExecutionState>(GetBit(spsr, 5)));
-					cpsr = std::bit_cast<CPSR>(spsr);
+					SetCPSR(spsr);
 				}
 			}
 			else {
-				cpsr.zero = result == 0;
-				cpsr.negative = GetBit(result, 31);
+				flags.n_result = flags.z_result = result;
 				if constexpr (is_arithmetic_instr) {
 					auto cond = [&] {
 						if constexpr (OneOf(instr, ADC, ADD, CMN)) return (op1 ^ result) & (op2 ^ result);
 						if constexpr (OneOf(instr, CMP, SBC, SUB)) return (op1 ^ op2) & (op1 ^ result);
 						if constexpr (OneOf(instr, RSB, RSC))      return (op1 ^ op2) & (op2 ^ result);
 					}();
-					cpsr.overflow = GetBit(cond, 31);
+					flags.overflow = GetBit(cond, 31);
 				}
-				if constexpr (instr == ADC)                 cpsr.carry = u64(op1) + u64(op2) + u64(cpsr.carry) > std::numeric_limits<u32>::max();
-				if constexpr (instr == ADD || instr == CMN) cpsr.carry = std::numeric_limits<u32>::max() - u32(op1) < u32(op2);
-				if constexpr (instr == CMP || instr == SUB) cpsr.carry = op2 <= op1; /* this is not borrow */
-				if constexpr (instr == RSB)                 cpsr.carry = op1 <= op2;
-				if constexpr (instr == RSC)                 cpsr.carry = u64(op1) - u64(cpsr.carry) + u64(1) <= u64(op2);
-				if constexpr (instr == SBC)                 cpsr.carry = u64(op2) - u64(cpsr.carry) + u64(1) <= u64(op1);
+				if constexpr (instr == ADC)                 flags.carry = u64(op1) + u64(op2) + u64(flags.carry) > std::numeric_limits<u32>::max();
+				if constexpr (instr == ADD || instr == CMN) flags.carry = std::numeric_limits<u32>::max() - u32(op1) < u32(op2);
+				if constexpr (instr == CMP || instr == SUB) flags.carry = op2 <= op1; /* this is not borrow */
+				if constexpr (instr == RSB)                 flags.carry = op1 <= op2;
+				if constexpr (instr == RSC)                 flags.carry = u64(op1) - u64(flags.carry) + u64(1) <= u64(op2);
+				if constexpr (instr == SBC)                 flags.carry = u64(op2) - u64(flags.carry) + u64(1) <= u64(op1);
 			}
 		}
 	}
 
 
-	void DecodeExecuteARM(u32 opcode)
+	template<u32 index /* opcode bits 27-20 in bits 11-4; opcode bits 7-4 in bits 3-0 */ >
+	constexpr ArmHandler DecodeARM()
 	{
-		if (opcode & 1 << 27) {
-			switch (opcode >> 24 & 7) {
-			case 0b000:
-				BlockDataTransfer<0>(opcode);
-				break;
-
-			case 0b001:
-				BlockDataTransfer<1>(opcode);
-				break;
-
-			case 0b010:
-				Branch(opcode);
-				break;
-
-			case 0b011:
-				BranchAndLink(opcode);
-				break;
+		using enum ArmDataProcessingInstruction;
 
-			case 0b100:
-			case 0b101:
-			case 0b110:
-				SignalException<Exception::UndefinedInstruction>();
-				break;
+		constexpr u32 hi = index >> 4;
+		constexpr u32 lo = index & 0xF;
 
-			case 0b111:
-				SoftwareInterrupt();
-				break;
-
-			default:
-				std::unreachable();
-			}
+		if constexpr (hi & 0x80) {
+			constexpr u32 op = hi >> 4 & 7;
+			if constexpr (op == 0b000) return BlockDataTransfer<0>;
+			else if constexpr (op == 0b001) return BlockDataTransfer<1>;
+			else if constexpr (op == 0b010) return Branch;
+			else if constexpr (op == 0b011) return BranchAndLink;
+			else if constexpr (op == 0b111) return [](u32 opcode) { SoftwareInterrupt(opcode >> 16 & 0xFF); };
+			else return [](u32) { SignalException<Exception::UndefinedInstruction>(); };
+		}
+		else if constexpr (hi & 0x40) {
+			return SingleDataTransfer;
+		}
+		else if constexpr (hi == 0x12 && lo == 0b0001) {
+			return BranchAndExchange;
+		}
+		else if constexpr ((hi & 0xFB) == 0x10 && lo == 0b1001) {
+			return SingleDataSwap;
+		}
+		else if constexpr ((hi & 0xFC) == 0x00 && lo == 0b1001) {
+			return Multiply;
 		}
-		else if (opcode & 1 << 26) {
-			SingleDataTransfer(opcode);
+		else if constexpr ((hi & 0xF8) == 0x08 && lo == 0b1001) {
+			return MultiplyLong;
 		}
-		else if ((opcode & 0xFFF'FFF0) == 0x12F'FF10) {
-			BranchAndExchange(opcode);
+		else if constexpr ((hi & 0xE4) == 0x00 && (lo & 0b1001) == 0b1001) {
+			return HalfwordDataTransfer<OffsetType::Register>;
 		}
-		else if ((opcode & 0xFB0'0FF0) == 0x100'0090) {
-			SingleDataSwap(opcode);
+		else if constexpr ((hi & 0xE4) == 0x04 && (lo & 0b1001) == 0b1001) {
+			return HalfwordDataTransfer<OffsetType::Immediate>;
 		}
-		else if ((opcode & 0xFC0'00F0) == 0x90) {
-			Multiply(opcode);
+		else if constexpr (hi == 0x10 && lo == 0) {
+			return MRS<0>;
 		}
-		else if ((opcode & 0xF80'00F0) == 0x80'0090) {
-			MultiplyLong(opcode);
+		else if constexpr (hi == 0x14 && lo == 0) {
+			return MRS<1>;
 		}
-		else if ((opcode & 0xE40'0F90) == 0x90) {
-			HalfwordDataTransfer<OffsetType::Register>(opcode);
+		else if constexpr ((hi == 0x12 && lo == 0) || hi == 0x32) {
+			return MSR<0>;
 		}
-		else if ((opcode & 0xE40'0090) == 0x40'0090) {
-			HalfwordDataTransfer<OffsetType::Immediate>(opcode);
+		else if constexpr ((hi == 0x16 && lo == 0) || hi == 0x36) {
+			return MSR<1>;
 		}
 		else {
-			using enum ArmDataProcessingInstruction;
-			switch (opcode >> 21 & 0xF) {
-			case 0b0000: DataProcessing<AND>(opcode); break;
-			case 0b0001: DataProcessing<EOR>(opcode); break;
-			case 0b0010: DataProcessing<SUB>(opcode); break;
-			case 0b0011: DataProcessing<RSB>(opcode); break;
-			case 0b0100: DataProcessing<ADD>(opcode); break;
-			case 0b0101: DataProcessing<ADC>(opcode); break;
-			case 0b0110: DataProcessing<SBC>(opcode); break;
-			case 0b0111: DataProcessing<RSC>(opcode); break;
-			case 0b1100: DataProcessing<ORR>(opcode); break;
-			case 0b1101: DataProcessing<MOV>(opcode); break;
-			case 0b1110: DataProcessing<BIC>(opcode); break;
-			case 0b1111: DataProcessing<MVN>(opcode); break;
-
-			case 0b1000:
-				(opcode & 0xFFF'0FFF) == 0x10F'0000
-					? MRS<0>(opcode)
-					: DataProcessing<TST>(opcode);
-				break;
+			constexpr std::array instr_by_opcode = {
+				AND, EOR, SUB, RSB, ADD, ADC, SBC, RSC, TST, TEQ, CMP, CMN, ORR, MOV, BIC, MVN
+			};
+			constexpr ArmDataProcessingInstruction instr = instr_by_opcode[hi >> 1 & 0xF];
+			constexpr bool reg_or_imm = hi >> 5 & 1;
+			constexpr bool set_conds = hi & 1;
+			return DataProcessing<instr, reg_or_imm, set_conds>;
+		}
+	}
 
-			case 0b1010:
-				(opcode & 0xFFF'0FFF) == 0x14F'0000
-					? MRS<1>(opcode)
-					: DataProcessing<CMP>(opcode);
-				break;
 
-			case 0b1001:
-				(opcode & 0xFF0'FFF0) == 0x120'F000 || (opcode & 0xFF0'F000) == 0x320'F000
-					? MSR<0>(opcode)
-					: DataProcessing<TEQ>(opcode);
-				break;
+	template<size_t... indices>
+	constexpr std::array<ArmHandler, sizeof...(indices)> MakeArmHandlerTable(std::index_sequence<indices...>)
+	{
+		return { DecodeARM<indices>()... };
+	}
 
-			case 0b1011:
-				(opcode & 0xFF0'FFF0) == 0x160'F000 || (opcode & 0xFF0'F000) == 0x360'F000
-					? MSR<1>(opcode)
-					: DataProcessing<CMN>(opcode);
-				break;
 
-			default:
-				std::unreachable();
-			}
-		}
+	/* Indexed by opcode bits 27-20 and 7-4; these are the only bits needed to tell all instructions apart. */
+	constexpr std::array<ArmHandler, 0x1000> arm_handlers = MakeArmHandlerTable(std::make_index_sequence<0x1000>{});
+
+
+	void DecodeExecuteARM(u32 opcode)
+	{
+		GetArmHandler(opcode)(opcode);
+	}
+
+
+	ArmHandler GetArmHandler(u32 opcode)
+	{
+		return arm_handlers[opcode >> 16 & 0xFF0 | opcode >> 4 & 0xF];
 	}
 
 
@@ -555,7 +537,7 @@ namespace CPU
 	{
 		auto rd = opcode >> 12 & 0xF;
 		if constexpr (psr == 0) {
-			r[rd] = std::bit_cast<u32>(cpsr);
+			r[rd] = GetCPSR();
 		}
 		else {
 			r[rd] = spsr;  /* TODO: read from spsr in user/system modes? */
@@ -592,8 +574,7 @@ namespace CPU
 		if (mode == cpsr_mode_bits_user) {
 			mask |= 0xF0000000 * GetBit(opcode, 19); /* User mode can only change the flag bits. TODO: bits 24-27? */
 			if constexpr (psr == 0) { /* cpsr */
-				u32 prev_cpsr = std::bit_cast<u32>(cpsr);
-				cpsr = std::bit_cast<CPSR>(oper & mask | prev_cpsr & ~mask);
+				SetCPSR(oper & mask | GetCPSR() & ~mask);
 			}
 			else { /* spsr */
 				spsr = oper & mask | spsr & ~mask;
@@ -619,8 +600,7 @@ namespace CPU
 					}
 					SetExecutionState(static_cast<ExecutionState>(GetBit(oper, 5)));
 				}
-				u32 prev_cpsr = std::bit_cast<u32>(cpsr);
-				cpsr = std::bit_cast<CPSR>(oper & mask | prev_cpsr & ~mask);
+				SetCPSR(oper & mask | GetCPSR() & ~mask);
 			}
 			else { /* spsr */
 				spsr = oper & mask | spsr & ~mask;
@@ -643,8 +623,7 @@ namespace CPU
 		}
 		r[rd] = result;
 		if (set_flags) {
-			cpsr.zero = result == 0;
-			cpsr.negative = GetBit(result, 31);
+			flags.n_result = flags.z_result = result;
 		}
 		uint cycles_stalled = accumulate + [&] {
 			if ((r[rs] & 0xFFFF'FF00) == 0) {
@@ -686,8 +665,8 @@ namespace CPU
 		r[rd_lo] = result & 0xFFFF'FFFF;
 		r[rd_hi] = result >> 32 & 0xFFFF'FFFF;
 		if (set_flags) {
-			cpsr.zero = result == 0;
-			cpsr.negative = GetBit(result, 63);
+			flags.n_result = u32(result >> 32);
+			flags.z_result = result != 0;
 		}
 		uint cycles_stalled = accumulate + [&] {
 			if ((r[rs] & 0xFFFF'FF00) == 0) {
@@ -795,13 +774,13 @@ namespace CPU
 			}
 			else if (shift_amount < 32) {
 				if (set_conds) {
-					cpsr.carry = GetBit(oper, 32 - shift_amount);
+					flags.carry = GetBit(oper, 32 - shift_amount);
 				}
 				return oper << shift_amount;
 			}
 			else {
 				if (set_conds) {
-					cpsr.carry = shift_amount == 32 ? GetBit(oper, 0) : 0;
+					flags.carry = shift_amount == 32 ? GetBit(oper, 0) : 0;
 				}
 				return 0;
 			}
@@ -809,14 +788,14 @@ namespace CPU
 		case 0b01: /* logical right */
 			if (shift_amount > 0 && shift_amount < 32) {
 				if (set_conds) {
-					cpsr.carry = GetBit(oper, shift_amount - 1);
+					flags.carry = GetBit(oper, shift_amount - 1);
 				}
 				return u32(oper) >> shift_amount;
 			}
 			else {
 				/* LSR#0: Interpreted as LSR#32, ie. result becomes zero, C becomes Bit 31 of the input */
 				if (set_conds) {
-					cpsr.carry = shift_amount > 32 ? 0 : GetBit(oper, 31);
+					flags.carry = shift_amount > 32 ? 0 : GetBit(oper, 31);
 				}
 				return 0;
 			}
@@ -824,7 +803,7 @@ namespace CPU
 		case 0b10: /* arithmetic right */
 			if (shift_amount > 0 && shift_amount < 32) {
 				if (set_conds) {
-					cpsr.carry = GetBit(oper, shift_amount - 1);
+					flags.carry = GetBit(oper, shift_amount - 1);
 				}
 				return s32(oper) >> shift_amount;
 			}
@@ -832,7 +811,7 @@ namespace CPU
 				/* ASR#0: Interpreted as ASR#32, ie. the result and C are filled by Bit 31 of the input. */
 				bool bit31 = GetBit(oper, 31);
 				if (set_conds) {
-					cpsr.carry = bit31;
+					flags.carry = bit31;
 				}
 				return bit31 ? 0xFFFF'FFFF : 0;
 			}
@@ -841,17 +820,17 @@ namespace CPU
 			if (shift_amount == 0) {
 				/* ROR#0: Interpreted as RRX#1 (RCR), like ROR#1, but Op2 Bit 31 set to old C. */
 				if (set_conds) {
-					auto prev_carry = cpsr.carry;
-					cpsr.carry = oper & 1;
+					auto prev_carry = flags.carry;
+					flags.carry = oper & 1;
 					return u32(oper) >> 1 | prev_carry << 31;
 				}
 				else {
-					return u32(oper) >> 1 | cpsr.carry << 31;
+					return u32(oper) >> 1 | flags.carry << 31;
 				}
 			}
 			else {
 				if (set_conds) {
-					cpsr.carry = oper >> ((shift_amount - 1) & 0x1F) & 1;
+					flags.carry = oper >> ((shift_amount - 1) & 0x1F) & 1;
 				}
 				return std::rotr(oper, shift_amount);
 			}
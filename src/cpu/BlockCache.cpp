@@ -0,0 +1,381 @@
+module CPU;
+
+import Bus;
+import Scheduler;
+
+#define pc (r[15])
+
+namespace CPU
+{
+	void BeginIdleLoopProbe()
+	{
+		std::copy(r.begin(), r.end() - 1, idle_loop_regs.begin());
+		idle_loop_flags = flags;
+		idle_loop_probe_active = true;
+		idle_loop_probe_failed = false;
+	}
+
+
+	template<ExecutionState state>
+	Block<state> BuildBlock(u32 addr)
+	{
+		using Opcode = CachedOpcode<state>;
+		constexpr u32 instr_size = sizeof(Opcode);
+
+		Block<state> block;
+		auto& instrs = block.instrs;
+		u32 start_addr = addr;
+		u32 region = addr >> 24;
+		bool end_of_block;
+		do {
+			Opcode opcode = Bus::Peek<Opcode>(addr);
+			/* When an instruction is executed, the instruction two steps ahead of it is fetched. */
+			u32 fetch_addr = addr + 2 * instr_size;
+			auto& instr = instrs.emplace_back();
+			if constexpr (state == ExecutionState::ARM) {
+				instr.handler = GetArmHandler(opcode);
+				end_of_block = EndsArmBlock(opcode);
+			}
+			else {
+				instr.handler = GetThumbHandler(opcode);
+				end_of_block = EndsThumbBlock(opcode);
+			}
+			instr.opcode = opcode;
+			if (Bus::IsPrefetchedCode(fetch_addr)) {
+				instr.cycles = { 0, 0 }; /* timed on execution */
+			}
+			else {
+				instr.cycles[0] = u8(1 + Bus::GetAccessCycles<Opcode>(fetch_addr, false));
+				instr.cycles[1] = u8(1 + Bus::GetAccessCycles<Opcode>(fetch_addr, true));
+			}
+			addr += instr_size;
+		} while (!end_of_block && instrs.size() < max_block_instrs && addr >> 24 == region && IsCacheable(addr));
+
+		/* Register the block with every WRAM page it overlaps, and with the page of the opcode following it,
+		   which is read into the pipeline when the block is left at its end */
+		if (region == 2 || region == 3) {
+			u32 key = start_addr | std::to_underlying(state);
+			for (u32 page_addr = start_addr & ~((1 << code_page_shift) - 1); page_addr <= addr; page_addr += 1 << code_page_shift) {
+				if (region == 2) board_wram_code_pages[page_addr >> code_page_shift & 0x3FF].push_back(key);
+				else             chip_wram_code_pages[page_addr >> code_page_shift & 0x7F].push_back(key);
+			}
+		}
+		block.may_be_idle_loop = IsIdleLoopCandidate<state>(block, start_addr);
+		return block;
+	}
+
+
+	template<ExecutionState state>
+	void EndIdleLoopProbe(u32 block_addr)
+	{
+		/* Called after the block has flushed the pipeline; pc has advanced past the first fetch at the branch target. */
+		idle_loop_probe_active = false;
+		bool idle = !idle_loop_probe_failed
+			&& pc - sizeof(CachedOpcode<state>) == block_addr
+			&& std::equal(r.begin(), r.end() - 1, idle_loop_regs.begin())
+			&& flags.n_result == idle_loop_flags.n_result
+			&& flags.z_result == idle_loop_flags.z_result
+			&& flags.carry == idle_loop_flags.carry
+			&& flags.overflow == idle_loop_flags.overflow;
+		if (idle) {
+			cycle = std::max(cycle, Scheduler::next_deadline);
+		}
+	}
+
+
+	bool EndsArmBlock(u32 opcode)
+	{
+		if ((opcode & 0x0E00'0000) == 0x0A00'0000) return true; /* B, BL */
+		if ((opcode & 0x0F00'0000) == 0x0F00'0000) return true; /* SWI */
+		if ((opcode & 0x0FFF'FFF0) == 0x012F'FF10) return true; /* BX */
+		if ((opcode & 0x0E10'8000) == 0x0810'8000) return true; /* LDM with r15 in the register list */
+		if ((opcode & 0x0C10'F000) == 0x0410'F000) return true; /* LDR r15 */
+		if ((opcode & 0x0C00'F000) == 0x0000'F000) return true; /* Data processing with rd = r15 */
+		return false;
+	}
+
+
+	bool EndsThumbBlock(u16 opcode)
+	{
+		if ((opcode & 0xF000) == 0xD000) return true; /* Conditional branch, SWI */
+		if ((opcode & 0xF800) == 0xE000) return true; /* Unconditional branch */
+		if ((opcode & 0xF800) == 0xF800) return true; /* Second half of BL */
+		if ((opcode & 0xFF00) == 0x4700) return true; /* BX */
+		if ((opcode & 0xFC87) == 0x4487) return true; /* Hi register operation with rd = r15 */
+		if ((opcode & 0xFF00) == 0xBD00) return true; /* POP {.., pc} */
+		return false;
+	}
+
+
+	template<ExecutionState state>
+	bool ExecuteCachedInstr(CachedInstrType<state> instr)
+	{
+		if constexpr (state == ExecutionState::ARM) {
+			if (CheckCondition(instr.opcode >> 28)) {
+				instr.handler(instr.opcode);
+			}
+		}
+		else {
+			instr.handler(instr.opcode);
+		}
+		if (exception_has_occurred) {
+			exception_handler();
+			exception_has_occurred = false;
+		}
+		if (pipeline.step < 2) {
+			FetchAfterFlush();
+			return false;
+		}
+		bool sequential = Bus::AdvanceSequentialAccess<CachedOpcode<state>>(pc);
+		/* Zero marks fetches whose timing depends on the state of the prefetch buffer */
+		cycle += instr.cycles[sequential] ? instr.cycles[sequential] : 1 + Bus::GetPrefetchedCodeCycles<CachedOpcode<state>>(pc, sequential);
+		pc += sizeof(CachedOpcode<state>);
+		return true;
+	}
+
+
+	void FetchAfterFlush()
+	{
+		/* The pipeline was flushed; continue as StepPipeline would, by fetching from the new pc. */
+		pipeline.opcode[pipeline.index] = Fetch();
+		pipeline.index ^= 1;
+		++cycle;
+	}
+
+
+	template<ExecutionState state>
+	Block<state>* FindBlock(u32 addr)
+	{
+		auto& blocks = GetBlocks<state>();
+		auto block_it = blocks.find(addr);
+		if (block_it == blocks.end()) {
+			if (!IsCacheable(addr)) {
+				return nullptr;
+			}
+			block_it = blocks.emplace(addr, BuildBlock<state>(addr)).first;
+		}
+		return &block_it->second;
+	}
+
+
+	void FlushBlockCache()
+	{
+		arm_blocks.clear();
+		thumb_blocks.clear();
+		for (auto& page : board_wram_code_pages) page.clear();
+		for (auto& page : chip_wram_code_pages) page.clear();
+		InvalidateFetchPage();
+		block_invalidated = true;
+		jit_code_size = 0; /* nothing is emitted before a running block returns */
+	}
+
+
+	template<ExecutionState state>
+	std::unordered_map<u32, Block<state>>& GetBlocks()
+	{
+		if constexpr (state == ExecutionState::ARM) return arm_blocks;
+		else                                        return thumb_blocks;
+	}
+
+
+	void InvalidateBlocks(u32 addr)
+	{
+		auto& page = (addr >> 24 & 0xF) == 2
+			? board_wram_code_pages[addr >> code_page_shift & 0x3FF]
+			: chip_wram_code_pages[addr >> code_page_shift & 0x7F];
+		if (page.empty()) {
+			return;
+		}
+		for (u32 key : page) {
+			if (key & 1) thumb_blocks.erase(key & ~1);
+			else         arm_blocks.erase(key);
+		}
+		page.clear();
+		block_invalidated = true;
+	}
+
+
+	bool IsCacheable(u32 addr)
+	{
+		switch (addr >> 24) {
+		case 0x0: return addr <= 0x3FFF; /* BIOS */
+		case 0x2: case 0x3: return true; /* WRAM */
+		case 0x8: case 0x9: case 0xA: case 0xB: case 0xC: case 0xD: return true; /* Game Pak ROM */
+		default: return false;
+		}
+	}
+
+
+	bool IsEventDrivenIoReg(u32 addr)
+	{
+		/* LCD registers, and IE/IF/WAITCNT/IME. Timer counters, keypad input etc. may change at any time. */
+		return addr < 0x400'0060 || addr >= 0x400'0200 && addr < 0x400'020C;
+	}
+
+
+	template<ExecutionState state>
+	bool IsIdleLoopCandidate(const Block<state>& block, u32 addr)
+	{
+		if (block.instrs.size() > max_idle_loop_instrs) {
+			return false;
+		}
+		for (size_t i = 0; i < block.instrs.size() - 1; ++i) {
+			if constexpr (state == ExecutionState::ARM) {
+				if (!IsSideEffectFreeArm(block.instrs[i].opcode)) return false;
+			}
+			else {
+				if (!IsSideEffectFreeThumb(block.instrs[i].opcode)) return false;
+			}
+		}
+		/* The last instruction must be a branch back to the start of the block */
+		u32 branch_addr = addr + u32(block.instrs.size() - 1) * sizeof(CachedOpcode<state>);
+		auto branch = block.instrs.back().opcode;
+		if constexpr (state == ExecutionState::ARM) {
+			return (branch & 0x0F00'0000) == 0x0A00'0000 /* B (without link) */
+				&& branch_addr + 8 + SignExtend<s32, 26>((branch & 0xFF'FFFF) << 2) == addr;
+		}
+		else {
+			if ((branch & 0xF000) == 0xD000 && (branch & 0x0F00) < 0x0E00) { /* conditional branch */
+				return branch_addr + 4 + SignExtend<s32, 9>(branch << 1 & 0x1FE) == addr;
+			}
+			if ((branch & 0xF800) == 0xE000) { /* unconditional branch */
+				return branch_addr + 4 + SignExtend<s32, 12>(branch << 1 & 0xFFE) == addr;
+			}
+			return false;
+		}
+	}
+
+
+	bool IsSideEffectFreeArm(u32 opcode)
+	{
+		/* Loads and ALU operations only. Changes to registers (e.g. base writeback) are caught when comparing the state.
+		   Loads may read from anywhere. Reads from I/O registers and the EEPROM are vetted through NotifyDeviceRead. All other
+		   memory is constant (BIOS, ROM), or only written by the CPU and by DMA (WRAM, palette RAM, VRAM, OAM, SRAM). DMA only
+		   starts from CPU writes and scheduler events, and the flash status bit only changes on a scheduler event, so none of it
+		   can change before the deadline that a detected idle loop skips to. */
+		if ((opcode & 0x0C00'0000) == 0x0400'0000) return opcode & 1 << 20; /* LDR */
+		if ((opcode & 0x0E00'0090) == 0x0000'0090 && (opcode & 0x60)) return opcode & 1 << 20; /* LDRH, LDRSB, LDRSH */
+		if ((opcode & 0x0FB0'0FF0) == 0x0100'0090) return false; /* SWP */
+		if ((opcode & 0x0DB0'F000) == 0x0120'F000) return false; /* MSR */
+		return (opcode & 0x0C00'0000) == 0; /* Data processing, multiply, MRS */
+	}
+
+
+	bool IsSideEffectFreeThumb(u16 opcode)
+	{
+		/* As for ARM; loads may read from anywhere */
+		switch (opcode >> 12) {
+		case 0x0: case 0x1: case 0x2: case 0x3: return true; /* Formats 1-3 */
+		case 0x4: return (opcode & 0xFF00) != 0x4700; /* ALU, hi register operations, PC-relative load; BX excluded */
+		case 0x5: return opcode & 1 << 9 ? (opcode & 0x0C00) != 0 : (opcode & 1 << 11) != 0; /* loads with register offset */
+		case 0x6: case 0x7: case 0x8: case 0x9: return opcode & 1 << 11; /* loads with immediate offset, SP-relative loads */
+		case 0xA: return true; /* Load address */
+		case 0xB: return (opcode & 0xFF00) == 0xB000; /* Add offset to SP */
+		default: return false;
+		}
+	}
+
+
+	void NotifyDeviceRead(u32 addr)
+	{
+		/* Called on reads from I/O registers and the EEPROM. Of these, an idle loop may only poll the registers that change
+		   on scheduler events alone. EEPROM reads advance its serial transfer, and are never event-driven. */
+		if (idle_loop_probe_active && !IsEventDrivenIoReg(addr)) {
+			idle_loop_probe_failed = true;
+		}
+	}
+
+
+	template<ExecutionState state>
+	void RefillPipeline(CachedOpcode<state> prefetched_opcode)
+	{
+		/* Leave the pipeline in the state it would be in had the instructions been stepped through.
+		   The fetches have already been accounted for. The opcode to be executed next was fetched before the last
+		   instruction was executed, which may have overwritten it since, and is passed in. The one after it
+		   was fetched after the last instruction, and is read from memory. */
+		using Opcode = CachedOpcode<state>;
+		pipeline.opcode[0] = prefetched_opcode;
+		pipeline.opcode[1] = Bus::Peek<Opcode>(pc - sizeof(Opcode));
+		pipeline.index = 0;
+	}
+
+
+	template<ExecutionState state>
+	void RunBlock()
+	{
+		using Opcode = CachedOpcode<state>;
+		auto block = FindBlock<state>(pc - 2 * sizeof(Opcode));
+		if (!block) {
+			StepPipeline();
+			return;
+		}
+
+		/* The opcodes in the pipeline are executed as they were when fetched. If memory has been written since
+		   (by the last instruction run, or by DMA), they no longer match the block, and are stepped through instead. */
+		auto instr_ptr = block->instrs.data();
+		auto instr_end = instr_ptr + block->instrs.size();
+		Opcode prefetched_opcode = instr_end - instr_ptr > 1 ? instr_ptr[1].opcode : Bus::Peek<Opcode>(pc - sizeof(Opcode));
+		if (pipeline.opcode[pipeline.index] != instr_ptr->opcode || pipeline.opcode[pipeline.index ^ 1] != prefetched_opcode) {
+			StepPipeline();
+			return;
+		}
+
+		/* A write may invalidate (and free) the block while it is running. The block is therefore only
+		   accessed before an instruction is executed, and the loop exits as soon as 'block_invalidated' is set. */
+		u32 addr = pc - 2 * sizeof(Opcode);
+		block_invalidated = false;
+		if (block->may_be_idle_loop) {
+			BeginIdleLoopProbe();
+		}
+		/* A pending exception is taken after the first instruction, which the translated code does not check for */
+		if (backend == Backend::Jit && !exception_has_occurred && (block->jit_code || CompileBlock<state>(*block, addr))) {
+			s64 exit_opcode = block->jit_code();
+			if (exit_opcode >= 0) {
+				idle_loop_probe_active = false;
+				RefillPipeline<state>(Opcode(exit_opcode));
+			}
+			else {
+				FlushPipeline(); /* translated branches leave this to here */
+				FetchAfterFlush();
+				if (idle_loop_probe_active) {
+					EndIdleLoopProbe<state>(addr);
+				}
+			}
+			return;
+		}
+		while (instr_ptr != instr_end && cycle < Scheduler::next_deadline && !block_invalidated) {
+			auto instr = *instr_ptr++;
+			/* The opcode in the pipeline behind 'instr'. Past the end of the block, it is read before 'instr' can overwrite it. */
+			prefetched_opcode = instr_ptr != instr_end ? instr_ptr->opcode : Bus::Peek<Opcode>(pc - sizeof(Opcode));
+			if (!ExecuteCachedInstr<state>(instr)) {
+				if (idle_loop_probe_active) {
+					EndIdleLoopProbe<state>(addr);
+				}
+				return;
+			}
+		}
+		idle_loop_probe_active = false;
+		RefillPipeline<state>(prefetched_opcode);
+	}
+
+
+	void SetBackend(Backend new_backend)
+	{
+		if (new_backend == Backend::Jit && !EnableJit()) {
+			new_backend = Backend::CachedInterpreter;
+		}
+		backend = new_backend;
+	}
+
+
+	template void EndIdleLoopProbe<ExecutionState::ARM>(u32);
+	template void EndIdleLoopProbe<ExecutionState::THUMB>(u32);
+	template bool ExecuteCachedInstr<ExecutionState::ARM>(ArmCachedInstr);
+	template bool ExecuteCachedInstr<ExecutionState::THUMB>(ThumbCachedInstr);
+	template Block<ExecutionState::ARM>* FindBlock<ExecutionState::ARM>(u32);
+	template Block<ExecutionState::THUMB>* FindBlock<ExecutionState::THUMB>(u32);
+	template void RefillPipeline<ExecutionState::ARM>(u32);
+	template void RefillPipeline<ExecutionState::THUMB>(u16);
+	template void RunBlock<ExecutionState::ARM>();
+	template void RunBlock<ExecutionState::THUMB>();
+}
@@ -2,6 +2,7 @@ module CPU;
 
 import Bus;
 import Debug;
+import IRQ;
 import PPU;
 import Scheduler;
 
@@ -19,21 +20,23 @@ namespace CPU
 
 	bool CheckCondition(u32 cond)
 	{
+		auto N = [] { return bool(flags.n_result >> 31); };
+		auto Z = [] { return flags.z_result == 0; };
 		switch (cond & 0xF) {
-		case  0: return cpsr.zero;
-		case  1: return !cpsr.zero;
-		case  2: return cpsr.carry;
-		case  3: return !cpsr.carry;
-		case  4: return cpsr.negative;
-		case  5: return !cpsr.negative;
-		case  6: return cpsr.overflow;
-		case  7: return !cpsr.overflow;
-		case  8: return cpsr.carry && !cpsr.zero;
-		case  9: return !cpsr.carry || cpsr.zero;
-		case 10: return cpsr.negative == cpsr.overflow;
-		case 11: return cpsr.negative != cpsr.overflow;
-		case 12: return !cpsr.zero && cpsr.negative == cpsr.overflow;
-		case 13: return cpsr.zero || cpsr.negative != cpsr.overflow;
+		case  0: return Z();
+		case  1: return !Z();
+		case  2: return flags.carry;
+		case  3: return !flags.carry;
+		case  4: return N();
+		case  5: return !N();
+		case  6: return flags.overflow;
+		case  7: return !flags.overflow;
+		case  8: return flags.carry && !Z();
+		case  9: return !flags.carry || Z();
+		case 10: return N() == flags.overflow;
+		case 11: return N() != flags.overflow;
+		case 12: return !Z() && N() == flags.overflow;
+		case 13: return Z() || N() != flags.overflow;
 		case 14: return true;
 		case 15: return false;
 		default: std::unreachable();
@@ -53,7 +56,7 @@ namespace CPU
 				DecodeExecuteARM(opcode);
 			}
 			if constexpr (Debug::log_instrs) {
-				Debug::LogInstruction(pc_when_current_instr_fetched, opcode, cond_strings[cond], execute_instruction, r, std::bit_cast<u32>(cpsr));
+				Debug::LogInstruction(pc_when_current_instr_fetched, opcode, cond_strings[cond], execute_instruction, r, GetCPSR());
 			}
 		}
 		else {
@@ -63,7 +66,7 @@ namespace CPU
 			}
 			DecodeExecuteTHUMB(opcode);
 			if constexpr (Debug::log_instrs) {
-				Debug::LogInstruction(pc_when_current_instr_fetched, opcode, r, std::bit_cast<u32>(cpsr));
+				Debug::LogInstruction(pc_when_current_instr_fetched, opcode, r, GetCPSR());
 			}
 		}
 		if (exception_has_occurred) {
@@ -73,28 +76,73 @@ namespace CPU
 	}
 
 
+	void ExitHalt()
+	{
+		halted = false;
+	}
+
+
+	u32 GetCPSR()
+	{
+		return std::bit_cast<u32>(cpsr) & 0x0FFF'FFFF
+			| (flags.n_result & 0x8000'0000)
+			| (flags.z_result == 0) << 30
+			| flags.carry << 29
+			| flags.overflow << 28;
+	}
+
+
 	u64 GetElapsedCycles()
 	{
 		return cycle;
 	}
 
+	constexpr RegisterBank GetRegisterBank(u32 mode_bits)
+	{
+		switch (mode_bits) {
+		case cpsr_mode_bits_user:
+		case cpsr_mode_bits_system:     return BANK_USR;
+		case cpsr_mode_bits_fiq:        return BANK_FIQ;
+		case cpsr_mode_bits_irq:        return BANK_IRQ;
+		case cpsr_mode_bits_supervisor: return BANK_SVC;
+		case cpsr_mode_bits_abort:      return BANK_ABT;
+		case cpsr_mode_bits_undefined:  return BANK_UND;
+		default: assert(false); return BANK_USR;
+		}
+	}
+
+
 	u32 Fetch()
 	{
 		if (execution_state == ExecutionState::ARM) {
-			u32 opcode = Bus::Read<u32>(pc);
-			pc += 4;
-			return opcode;
+			return FetchOpcode<u32>();
 		}
 		else {
-			u16 opcode = Bus::Read<u16>(pc);
-			pc += 2;
-			return opcode;
+			return FetchOpcode<u16>();
 		}
 	}
 
 
+	template<std::integral Opcode>
+	Opcode FetchOpcode()
+	{
+		Opcode opcode;
+		if (pc - fetch_page.start < fetch_page.size) {
+			std::memcpy(&opcode, fetch_page.host_ptr + (pc - fetch_page.start), sizeof(Opcode));
+			cycle += fetch_page.cycles[Bus::AdvanceSequentialAccess<Opcode>(pc)];
+		}
+		else {
+			opcode = Bus::ReadCode<Opcode>(pc);
+			RefreshFetchPage<Opcode>();
+		}
+		pc += sizeof(Opcode);
+		return opcode;
+	}
+
+
 	void FlushPipeline()
 	{
+		InvalidateFetchPage();
 		pipeline.index = 0;
 		pipeline.step = 1; /* TODO: if pipeline is flushed, next opcode has already been fetched.
 		This is a temporary solution; I don't know if the first instr should be fetched on the next cycle instead.
@@ -102,33 +150,91 @@ namespace CPU
 	}
 
 
+	void Halt()
+	{
+		/* Halt mode is left as soon as an enabled interrupt is requested, regardless of IME and the CPSR I bit */
+		if ((IRQ::ReadIE() & IRQ::ReadIF() & 0x3FFF) == 0) {
+			halted = true;
+			Scheduler::next_deadline = 0;
+		}
+	}
+
+
 	void Initialize()
 	{
 		r8_r12_non_fiq.fill(0);
 		r8_r12_fiq.fill(0);
 		r.fill(0);
-		r13_usr = r14_usr = 0;
-		r13_fiq = r14_fiq = 0;
-		r13_svc = r14_svc = 0;
-		r13_abt = r14_abt = 0;
-		r13_irq = r14_irq = 0;
-		r13_und = r14_und = 0;
-		spsr = spsr_fiq = spsr_svc = spsr_abt = spsr_irq = spsr_und = 0;
-		std::memset(&cpsr, 0, sizeof(cpsr));
+		banked_r13.fill(0);
+		banked_r14.fill(0);
+		banked_spsr.fill(0);
+		spsr = 0;
+		SetCPSR(0);
 		cpsr.mode = cpsr_mode_bits_supervisor;
 		cpsr.irq_disable = cpsr.fiq_disable = 1;
 		execution_state = ExecutionState::ARM;
+		halted = false;
+		FlushBlockCache();
+	}
+
+
+	void InvalidateFetchPage()
+	{
+		fetch_page.size = 0;
+	}
+
+
+	template<std::integral Opcode>
+	void RefreshFetchPage()
+	{
+		Bus::CodeRegion region = Bus::GetCodeRegion(pc);
+		if (region.size == 0) {
+			InvalidateFetchPage();
+			return;
+		}
+		fetch_page.host_ptr = region.host_ptr;
+		fetch_page.start = region.start;
+		fetch_page.size = region.size - (sizeof(Opcode) - 1);
+		/* Every access but the first one of a region has the same timing */
+		u32 timing_addr = region.start + sizeof(Opcode);
+		fetch_page.cycles[0] = u8(Bus::GetAccessCycles<Opcode>(timing_addr, false));
+		fetch_page.cycles[1] = u8(Bus::GetAccessCycles<Opcode>(timing_addr, true));
 	}
 
 
-	u64 Run(u64 cycles)
+	u64 Run()
 	{
-		suspended = false;
 		cycle = 0;
-		while (cycle < cycles && !suspended) {
-			StepPipeline();
+		if (halted) {
+			/* Nothing happens until the next event; the scheduler can jump straight to it */
+			return Scheduler::next_deadline;
 		}
-		return cycle;
+		while (cycle < Scheduler::next_deadline) {
+			/* Blocks are run once the pipeline is full. Logging needs every instruction to go through DecodeExecute. */
+			if (Debug::log_instrs || backend == Backend::Interpreter || pipeline.step < 2) {
+				StepPipeline();
+			}
+			else if (execution_state == ExecutionState::ARM) {
+				RunBlock<ExecutionState::ARM>();
+			}
+			else {
+				RunBlock<ExecutionState::THUMB>();
+			}
+		}
+		/* From here on, the scheduler accounts for the time that has passed */
+		u64 elapsed_cycles = cycle;
+		cycle = 0;
+		return elapsed_cycles;
+	}
+
+
+	void SetCPSR(u32 value)
+	{
+		cpsr = std::bit_cast<CPSR>(value);
+		flags.n_result = value & 0x8000'0000;
+		flags.z_result = !GetBit(value, 30);
+		flags.carry = GetBit(value, 29);
+		flags.overflow = GetBit(value, 28);
 	}
 
 
@@ -154,102 +260,37 @@ namespace CPU
 	template<Mode mode>
 	void SetMode()
 	{
+		constexpr u32 new_mode_bits = [] {
+			switch (mode) {
+			case Mode::User:       return cpsr_mode_bits_user;
+			case Mode::Fiq:        return cpsr_mode_bits_fiq;
+			case Mode::Irq:        return cpsr_mode_bits_irq;
+			case Mode::Supervisor: return cpsr_mode_bits_supervisor;
+			case Mode::Abort:      return cpsr_mode_bits_abort;
+			case Mode::Undefined:  return cpsr_mode_bits_undefined;
+			case Mode::System:     return cpsr_mode_bits_system;
+			}
+		}();
+		constexpr RegisterBank new_bank = GetRegisterBank(new_mode_bits);
+		RegisterBank old_bank = GetRegisterBank(cpsr.mode);
+
 		/* Store banked registers */
-		switch (cpsr.mode) {
-		case cpsr_mode_bits_system:
-		case cpsr_mode_bits_user:
-			std::copy(r.begin() + 8, r.end() - 3, r8_r12_non_fiq.begin());
-			r13_usr = r[13];
-			r14_usr = r[14];
-			break;
-
-		case cpsr_mode_bits_irq:
-			std::copy(r.begin() + 8, r.end() - 3, r8_r12_non_fiq.begin());
-			r13_irq = r[13];
-			r14_irq = r[14];
-			spsr_irq = spsr;
-			break;
-
-		case cpsr_mode_bits_supervisor:
-			std::copy(r.begin() + 8, r.end() - 3, r8_r12_non_fiq.begin());
-			r13_svc = r[13];
-			r14_svc = r[14];
-			spsr_svc = spsr;
-			break;
-
-		case cpsr_mode_bits_abort:
-			std::copy(r.begin() + 8, r.end() - 3, r8_r12_non_fiq.begin());
-			r13_abt = r[13];
-			r14_abt = r[14];
-			spsr_abt = spsr;
-			break;
-
-		case cpsr_mode_bits_undefined:
-			std::copy(r.begin() + 8, r.end() - 3, r8_r12_non_fiq.begin());
-			r13_und = r[13];
-			r14_und = r[14];
-			spsr_und = spsr;
-			break;
-
-		case cpsr_mode_bits_fiq:
-			std::copy(r.begin() + 8, r.end() - 3, r8_r12_fiq.begin());
-			r13_fiq = r[13];
-			r14_fiq = r[14];
-			spsr_fiq = spsr;
-			break;
-
-		default:
-			assert(false);
-			break;
+		banked_r13[old_bank] = r[13];
+		banked_r14[old_bank] = r[14];
+		banked_spsr[old_bank] = spsr;
+		if ((old_bank == BANK_FIQ) != (new_bank == BANK_FIQ)) {
+			auto& old_r8_r12 = old_bank == BANK_FIQ ? r8_r12_fiq : r8_r12_non_fiq;
+			auto& new_r8_r12 = new_bank == BANK_FIQ ? r8_r12_fiq : r8_r12_non_fiq;
+			std::copy(r.begin() + 8, r.end() - 3, old_r8_r12.begin());
+			std::copy(new_r8_r12.begin(), new_r8_r12.end(), r.begin() + 8);
 		}
 
 		/* Load banked registers */
-		if constexpr (mode == Mode::System) {
-			cpsr.mode = cpsr_mode_bits_system;
-			std::copy(r8_r12_non_fiq.begin(), r8_r12_non_fiq.end(), r.begin() + 8);
-			r[13] = r13_usr;
-			r[14] = r14_usr;
-		}
-		if constexpr (mode == Mode::User) {
-			cpsr.mode = cpsr_mode_bits_user;
-			std::copy(r8_r12_non_fiq.begin(), r8_r12_non_fiq.end(), r.begin() + 8);
-			r[13] = r13_usr;
-			r[14] = r14_usr;
-		}
-		if constexpr (mode == Mode::Irq) {
-			cpsr.mode = cpsr_mode_bits_irq;
-			spsr = spsr_irq;
-			std::copy(r8_r12_non_fiq.begin(), r8_r12_non_fiq.end(), r.begin() + 8);
-			r[13] = r13_irq;
-			r[14] = r14_irq;
-		}
-		if constexpr (mode == Mode::Supervisor) {
-			cpsr.mode = cpsr_mode_bits_supervisor;
-			spsr = spsr_svc;
-			std::copy(r8_r12_non_fiq.begin(), r8_r12_non_fiq.end(), r.begin() + 8);
-			r[13] = r13_svc;
-			r[14] = r14_svc;
-		}
-		if constexpr (mode == Mode::Abort) {
-			cpsr.mode = cpsr_mode_bits_abort;
-			spsr = spsr_abt;
-			std::copy(r8_r12_non_fiq.begin(), r8_r12_non_fiq.end(), r.begin() + 8);
-			r[13] = r13_abt;
-			r[14] = r14_abt;
-		}
-		if constexpr (mode == Mode::Undefined) {
-			cpsr.mode = cpsr_mode_bits_undefined;
-			spsr = spsr_und;
-			std::copy(r8_r12_non_fiq.begin(), r8_r12_non_fiq.end(), r.begin() + 8);
-			r[13] = r13_und;
-			r[14] = r14_und;
-		}
-		if constexpr (mode == Mode::Fiq) {
-			cpsr.mode = cpsr_mode_bits_fiq;
-			spsr = spsr_fiq;
-			std::copy(r8_r12_fiq.begin(), r8_r12_fiq.end(), r.begin() + 8);
-			r[13] = r13_fiq;
-			r[14] = r14_fiq;
+		cpsr.mode = new_mode_bits;
+		r[13] = banked_r13[new_bank];
+		r[14] = banked_r14[new_bank];
+		if constexpr (new_bank != BANK_USR) {
+			spsr = banked_spsr[new_bank];
 		}
 	}
 
@@ -283,12 +324,6 @@ namespace CPU
 	}
 
 
-	void SuspendRun()
-	{
-		suspended = true;
-	}
-
-
 	template void SetMode<Mode::User>();
 	template void SetMode<Mode::Fiq>();
 	template void SetMode<Mode::Irq>();
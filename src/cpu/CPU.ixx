@@ -6,26 +6,45 @@ import <algorithm>;
 import <array>;
 import <bit>;
 import <cassert>;
+import <cmath>;
 import <concepts>;
 import <cstring>;
 import <limits>;
+import <numbers>;
 import <string_view>;
+import <type_traits>;
+import <unordered_map>;
 import <utility>;
+import <vector>;
 
 namespace CPU
 {
 	export
 	{
+		enum class Backend {
+			Interpreter, /* fetches and decodes every instruction */
+			CachedInterpreter, /* runs pre-decoded basic blocks */
+			Jit /* runs basic blocks translated into host code (x86-64 only) */
+		};
+
 		void AddCycles(u64 cycles);
+		void ExitHalt();
+		void FlushBlockCache();
 		u64 GetElapsedCycles();
+		void Halt();
 		void Initialize();
-		u64 Run(u64 cycles);
+		void InvalidateBlocks(u32 addr);
+		void NotifyDeviceRead(u32 addr);
+		u64 Run();
+		void SetBackend(Backend new_backend);
+		void SetHleBios(bool enable);
 		void SetIRQ(bool new_irq);
 		void StreamState(SerializationStream& stream);
-		void SuspendRun();
 	}
 
+	using ArmHandler = void(*)(u32);
 	using ExceptionHandler = void(*)();
+	using ThumbHandler = void(*)(u16);
 
 	enum class ArmDataProcessingInstruction {
 		ADC, ADD, AND, BIC, CMN, CMP, EOR, MOV, MVN, ORR, RSB, RSC, SBC, SUB, TEQ, TST
@@ -39,10 +58,32 @@ namespace CPU
 		ARM = 0, THUMB = 1
 	} execution_state = ExecutionState::ARM;
 
+	enum class HleSwi : u8 {
+		Div = 0x06,
+		DivArm = 0x07,
+		Sqrt = 0x08,
+		ArcTan = 0x09,
+		ArcTan2 = 0x0A,
+		CpuSet = 0x0B,
+		CpuFastSet = 0x0C,
+		BgAffineSet = 0x0E,
+		ObjAffineSet = 0x0F,
+		LZ77UnCompWram = 0x11,
+		LZ77UnCompVram = 0x12,
+		HuffUnComp = 0x13,
+		RLUnCompWram = 0x14,
+		RLUnCompVram = 0x15
+	};
+
 	enum class Mode {
 		User, Fiq, Irq, Supervisor, Abort, Undefined, System
 	};
 
+	enum RegisterBank : uint {
+		BANK_USR, /* also system */
+		BANK_FIQ, BANK_SVC, BANK_ABT, BANK_IRQ, BANK_UND, NUM_REGISTER_BANKS
+	};
+
 	enum class OffsetType {
 		Register, Immediate
 	};
@@ -51,24 +92,94 @@ namespace CPU
 		ADC, AND, ASR, BIC, CMN, CMP, EOR, LSL, LSR, MUL, MVN, NEG, ORR, ROR, SBC, TST
 	};
 
+	/* A pre-decoded instruction of a cached block. 'cycles' holds the cost of the pipeline step executing it,
+	   i.e. one cycle plus the fetch of the instruction two steps ahead, for non-sequential and sequential fetches. */
+	template<typename Handler, std::integral Opcode>
+	struct CachedInstr {
+		Handler handler;
+		Opcode opcode;
+		std::array<u8, 2> cycles;
+	};
+
+	using ArmCachedInstr = CachedInstr<ArmHandler, u32>;
+	using ThumbCachedInstr = CachedInstr<ThumbHandler, u16>;
+
+	template<ExecutionState state> using CachedOpcode = std::conditional_t<state == ExecutionState::ARM, u32, u16>;
+	template<ExecutionState state> using CachedInstrType = std::conditional_t<state == ExecutionState::ARM, ArmCachedInstr, ThumbCachedInstr>;
+
+	/* Returns the opcode to refill the pipeline with when leaving the block, or -1 if the pipeline was flushed */
+	using JitCode = s64(*)();
+
+	template<ExecutionState state>
+	struct Block {
+		std::vector<CachedInstrType<state>> instrs;
+		bool may_be_idle_loop; /* short, free of stores, and branching back to its start */
+		JitCode jit_code = nullptr; /* translated on its first run with Backend::Jit */
+	};
+
 	constexpr std::string_view ArmDataProcessingInstructionToStr(ArmDataProcessingInstruction instr);
+	template<ExecutionState state> Block<state> BuildBlock(u32 addr);
 	bool CheckCondition(u32 cond);
+	template<ExecutionState state> bool CompileBlock(Block<state>& block, u32 addr);
 	void DecodeExecute(u32 opcode);
 	void DecodeExecuteARM(u32 opcode);
 	void DecodeExecuteTHUMB(u16 opcode);
+	void DisableJit(const char* reason);
+	bool EnableJit();
 	constexpr std::string_view ExceptionToStr(Exception exc);
 	u32 Fetch();
+	void FetchAfterFlush();
 	void FlushPipeline();
+	bool EndsArmBlock(u32 opcode);
+	bool EndsThumbBlock(u16 opcode);
+	void BeginIdleLoopProbe();
+	template<ExecutionState state> void EndIdleLoopProbe(u32 block_addr);
+	template<ExecutionState state> bool ExecuteCachedInstr(CachedInstrType<state> instr);
+	template<ExecutionState state> Block<state>* FindBlock(u32 addr);
+	template<std::integral Opcode> Opcode FetchOpcode();
+	ArmHandler GetArmHandler(u32 opcode);
+	template<ExecutionState state> std::unordered_map<u32, Block<state>>& GetBlocks();
+	u32 GetCPSR();
+	constexpr RegisterBank GetRegisterBank(u32 mode_bits);
 	template<Exception> ExceptionHandler GetExceptionHandler();
 	template<Exception> constexpr uint GetExceptionPriority();
+	template<std::integral Opcode> u64 GetJitPrefetchedFetchCycles(u32 addr);
+	ThumbHandler GetThumbHandler(u16 opcode);
 	void HandleDataAbortException();
 	void HandleFiqException();
 	void HandleIrqException();
+	void HandleJitException();
 	void HandlePrefetchAbortException();
 	void HandleResetException();
 	void HandleSoftwareInterruptException();
 	void HandleUndefinedInstructionException();
+	s32 HleArcTan(s32 x);
+	u16 HleArcTan2(s32 x, s32 y);
+	void HleBgAffineSet(u32 src, u32 dst, u32 count);
+	template<std::integral Int> void HleCopy(u32 src, u32 dst, u32 count, bool fill);
+	void HleCpuFastSet(u32 src, u32 dst, u32 control);
+	void HleCpuSet(u32 src, u32 dst, u32 control);
+	bool HleDiv(s32 numerator, s32 denominator);
+	void HleHuffUnComp(u32 src, u32 dst);
+	void HleObjAffineSet(u32 src, u32 dst, u32 count, u32 offset);
+	template<std::integral Int> Int HleRead(u32 addr);
+	s32 HleSine(u8 angle);
+	bool HleSoftwareInterrupt(u8 comment);
+	void HleUnComp(HleSwi swi, u32 src, u32 dst);
+	template<std::integral Int> void HleWrite(u32 addr, Int data);
+	void InvalidateFetchPage();
+	bool IsCacheable(u32 addr);
+	bool IsEventDrivenIoReg(u32 addr);
+	template<ExecutionState state> bool IsIdleLoopCandidate(const Block<state>& block, u32 addr);
+	bool IsSideEffectFreeArm(u32 opcode);
+	bool IsSideEffectFreeThumb(u16 opcode);
+	template<ExecutionState state> void RefillPipeline(CachedOpcode<state> prefetched_opcode);
+	template<std::integral Opcode> void RefreshFetchPage();
+	void ResetJitCode();
+	template<ExecutionState> void RunBlock();
+	void SetCPSR(u32 value);
 	void SetExecutionState(ExecutionState state);
+	bool SetJitCodeWritable(u8* code_ptr, size_t size, bool writable);
 	template<Mode> void SetMode();
 	template<Exception> void SignalException();
 	void StallPipeline(uint cycles);
@@ -80,7 +191,7 @@ namespace CPU
 	void Branch(u32 opcode);
 	void BranchAndExchange(u32 opcode);
 	void BranchAndLink(u32 opcode);
-	template<ArmDataProcessingInstruction> void DataProcessing(u32 opcode);
+	template<ArmDataProcessingInstruction, bool, bool> void DataProcessing(u32 opcode);
 	template<OffsetType> void HalfwordDataTransfer(u32 opcode);
 	template<bool> void MRS(u32 opcode);
 	template<bool> void MSR(u32 opcode);
@@ -91,26 +202,26 @@ namespace CPU
 	void SingleDataTransfer(u32 opcode);
 
 	/* THUMB instructions */
-	void AddOffsetToStackPointer(u16 opcode);
-	void AddSubtract(u16 opcode);
+	template<bool> void AddOffsetToStackPointer(u16 opcode);
+	template<bool, bool> void AddSubtract(u16 opcode);
 	template<ThumbAluInstruction> void AluOperation(u16 opcode);
-	void ConditionalBranch(u16 opcode);
-	void HiReg(u16 opcode);
-	void LoadAddress(u16 opcode);
-	template<bool> void LoadStoreImmOffset(u16 opcode);
-	void LoadStoreHalfword(u16 opcode);
-	void LoadStoreRegOffset(u16 opcode);
-	void LoadStoreSignExtendedByteHalfword(u16 opcode);
-	void LongBranchWithLink(u16 opcode);
-	void MoveCompareAddSubtractImm(u16 opcode);
-	void MultipleLoadStore(u16 opcode);
+	template<u16> void ConditionalBranch(u16 opcode);
+	template<u16, bool, bool> void HiReg(u16 opcode);
+	template<bool> void LoadAddress(u16 opcode);
+	template<bool, bool> void LoadStoreImmOffset(u16 opcode);
+	template<bool> void LoadStoreHalfword(u16 opcode);
+	template<bool, bool> void LoadStoreRegOffset(u16 opcode);
+	template<u16> void LoadStoreSignExtendedByteHalfword(u16 opcode);
+	template<bool> void LongBranchWithLink(u16 opcode);
+	template<u16> void MoveCompareAddSubtractImm(u16 opcode);
+	template<bool> void MultipleLoadStore(u16 opcode);
 	void PcRelativeLoad(u16 opcode);
-	void PushPopRegisters(u16 opcode);
-	void Shift(u16 opcode);
-	void SpRelativeLoadStore(u16 opcode);
+	template<bool, bool> void PushPopRegisters(u16 opcode);
+	template<u16> void Shift(u16 opcode);
+	template<bool> void SpRelativeLoadStore(u16 opcode);
 	void UnconditionalBranch(u16 opcode);
 
-	void SoftwareInterrupt();
+	void SoftwareInterrupt(u8 comment);
 
 	constexpr u32 cpsr_mode_bits_user = 16;
 	constexpr u32 cpsr_mode_bits_fiq = 17;
@@ -149,18 +260,26 @@ namespace CPU
 		u32 negative : 1;
 	} cpsr;
 
+	/* The NZCV bits of 'cpsr' are not kept up to date; flag-setting instructions write 'flags' instead,
+	   without read-modify-writes of the bitfield. N and Z are only evaluated when read (CheckCondition, GetCPSR). */
+	struct Flags {
+		u32 n_result; /* N = bit 31 */
+		u32 z_result; /* Z = (z_result == 0) */
+		bool carry;
+		bool overflow;
+	} flags;
+
+	bool halted; /* while set, Run consumes the time until the next deadline without executing anything */
+	bool hle_bios = false; /* run the most used BIOS functions natively instead of in the emulated BIOS */
 	bool irq;
-	bool suspended;
 
+	/* Banked registers, indexed by RegisterBank. A mode switch only saves and restores R13, R14 and SPSR
+	   of the old and new bank; R8-R12 are only swapped when entering or leaving FIQ mode. */
 	std::array<u32, 5> r8_r12_non_fiq; /* R8-R12 */
 	std::array<u32, 5> r8_r12_fiq; /* R8-R12 */
-	u32 r13_usr, r14_usr; /* also system */
-	u32 r13_fiq, r14_fiq;
-	u32 r13_svc, r14_svc;
-	u32 r13_abt, r14_abt;
-	u32 r13_irq, r14_irq;
-	u32 r13_und, r14_und;
-	u32 spsr_fiq, spsr_svc, spsr_abt, spsr_irq, spsr_und;
+	std::array<u32, NUM_REGISTER_BANKS> banked_r13;
+	std::array<u32, NUM_REGISTER_BANKS> banked_r14;
+	std::array<u32, NUM_REGISTER_BANKS> banked_spsr; /* the BANK_USR entry is unused */
 	u32 spsr;
 	std::array<u32, 16> r; /* currently active registers */
 
@@ -170,6 +289,58 @@ namespace CPU
 
 	u64 cycle;
 
+	/* The code region that the PC is in, so that sequential opcode fetches can skip Bus::Read. It is only valid for
+	   the current opcode width, and is dropped on every pipeline flush (branches, exceptions, state switches)
+	   and waitstate change; fetches outside of it go through Bus::Read and then set it up for the new region. */
+	struct FetchPage {
+		const u8* host_ptr; /* host address of 'start' */
+		u32 start;
+		u32 size; /* number of bytes from 'start' at which an opcode can begin; 0 when invalid */
+		std::array<u8, 2> cycles; /* non-sequential, sequential */
+	} fetch_page;
+
+	/* Block cache. Blocks are keyed by the address of their first instruction. For each 256-byte page of WRAM,
+	   the keys of the blocks overlapping it are recorded (with bit 0 set for THUMB blocks), so that writes can invalidate them. */
+	constexpr uint max_block_instrs = 64;
+	constexpr uint code_page_shift = 8;
+
+	std::unordered_map<u32, Block<ExecutionState::ARM>> arm_blocks;
+	std::unordered_map<u32, Block<ExecutionState::THUMB>> thumb_blocks;
+	std::array<std::vector<u32>, (0x40000 >> code_page_shift)> board_wram_code_pages;
+	std::array<std::vector<u32>, (0x8000 >> code_page_shift)> chip_wram_code_pages;
+	bool block_invalidated;
+
+	/* Idle loop detection. While a candidate block runs, the registers and flags at its start are kept, and reads
+	   of I/O registers that may change other than through scheduler events mark the iteration as not idle.
+	   If the block branches back to its start with all state unchanged, every further iteration until the next event
+	   would be identical, so the CPU skips ahead to it. */
+	constexpr uint max_idle_loop_instrs = 8;
+
+	bool idle_loop_probe_active;
+	bool idle_loop_probe_failed;
+	std::array<u32, 15> idle_loop_regs;
+	Flags idle_loop_flags;
+
+	Backend backend = Backend::CachedInterpreter;
+
+	/* JIT code buffer. Code is appended until the buffer is full, after which all of it is dropped. */
+	constexpr size_t jit_code_buffer_capacity = 16 * 1024 * 1024;
+
+	u8* jit_code_buffer;
+	size_t jit_code_size;
+	size_t jit_page_size;
+
+	/* Displacements from 'r' of the state accessed by translated code */
+	struct JitStateOffsets {
+		s32 cycle;
+		s32 n_result, z_result, carry, overflow;
+		s32 pipeline_step;
+		s32 exception_has_occurred;
+		s32 block_invalidated;
+		s32 next_deadline;
+		s32 next_sequential_addr;
+	} jit_offsets;
+
 	/// debugging
 	u32 pc_when_current_instr_fetched;
 }
\ No newline at end of file
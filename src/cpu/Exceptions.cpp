@@ -50,10 +50,10 @@ namespace CPU
 	void HandleDataAbortException()
 	{
 		/* store the address of the instruction after the one that caused the exception to occur */
-		r14_abt = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_ABT] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_data_abort;
 		FlushPipeline();
-		spsr_abt = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_ABT] = GetCPSR();
 		cpsr.irq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Abort>();
@@ -62,10 +62,10 @@ namespace CPU
 
 	void HandleFiqException()
 	{
-		r14_fiq = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_FIQ] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_fiq;
 		FlushPipeline();
-		spsr_fiq = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_FIQ] = GetCPSR();
 		cpsr.irq_disable = cpsr.fiq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Fiq>();
@@ -74,10 +74,10 @@ namespace CPU
 
 	void HandleIrqException()
 	{
-		r14_irq = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_IRQ] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_irq;
 		FlushPipeline();
-		spsr_irq = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_IRQ] = GetCPSR();
 		cpsr.irq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Irq>();
@@ -86,10 +86,10 @@ namespace CPU
 
 	void HandlePrefetchAbortException()
 	{
-		r14_abt = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_ABT] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_prefetch_abort;
 		FlushPipeline();
-		spsr_abt = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_ABT] = GetCPSR();
 		cpsr.irq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Abort>();
@@ -98,10 +98,10 @@ namespace CPU
 
 	void HandleResetException()
 	{
-		r14_svc = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_SVC] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_reset;
 		FlushPipeline();
-		spsr_svc = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_SVC] = GetCPSR();
 		cpsr.irq_disable = cpsr.fiq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Supervisor>();
@@ -110,10 +110,10 @@ namespace CPU
 
 	void HandleSoftwareInterruptException()
 	{
-		r14_svc = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_SVC] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_software_int;
 		FlushPipeline();
-		spsr_svc = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_SVC] = GetCPSR();
 		cpsr.irq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Supervisor>();
@@ -122,10 +122,10 @@ namespace CPU
 
 	void HandleUndefinedInstructionException()
 	{
-		r14_und = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
+		banked_r14[BANK_UND] = pc - (execution_state == ExecutionState::ARM ? 4 : 2);
 		pc = exception_vector_undefined_instr;
 		FlushPipeline();
-		spsr_und = std::bit_cast<u32>(cpsr);
+		banked_spsr[BANK_UND] = GetCPSR();
 		cpsr.irq_disable = 1;
 		SetExecutionState(ExecutionState::ARM);
 		SetMode<Mode::Undefined>();
@@ -0,0 +1,368 @@
+module CPU;
+
+import Bus;
+import PPU;
+
+/* High-level emulation of the BIOS functions that games spend the most time in. When enabled, SWIs with these
+   numbers are run natively instead of entering the BIOS; all others still go through the exception vector.
+   The cycle costs charged are rough estimates of the time taken by the official BIOS, and only meant to keep
+   the timing of the rest of the system plausible. Memory is accessed directly where there is host memory behind it. */
+
+namespace CPU
+{
+	/* Approximate cycle costs; the SWI entry and return are included in the base costs */
+	constexpr uint swi_base_cycles = 24;
+	constexpr uint div_cycles = 80;
+	constexpr uint sqrt_cycles = 120;
+	constexpr uint arctan_cycles = 40;
+	constexpr uint arctan2_cycles = 90;
+	constexpr uint cpu_set_cycles_per_unit = 8;
+	constexpr uint cpu_fast_set_cycles_per_word = 2;
+	constexpr uint affine_set_cycles_per_entry = 60;
+	constexpr uint lz77_cycles_per_byte = 16;
+	constexpr uint huff_cycles_per_bit = 6;
+	constexpr uint rl_cycles_per_byte = 8;
+
+	s32 HleArcTan(s32 x)
+	{
+		s32 a = -(x * x >> 14);
+		s32 b = (0xA9 * a >> 14) + 0x390;
+		b = (b * a >> 14) + 0x91C;
+		b = (b * a >> 14) + 0xFB6;
+		b = (b * a >> 14) + 0x16AA;
+		b = (b * a >> 14) + 0x2081;
+		b = (b * a >> 14) + 0x3651;
+		b = (b * a >> 14) + 0xA2F9;
+		return x * b >> 16;
+	}
+
+
+	u16 HleArcTan2(s32 x, s32 y)
+	{
+		if (y == 0) return x >= 0 ? 0 : 0x8000;
+		if (x == 0) return y >= 0 ? 0x4000 : 0xC000;
+		if (y >= 0) {
+			if (x >= 0) {
+				if (x >= y) return u16(HleArcTan((y << 14) / x));
+			}
+			else if (-x >= y) {
+				return u16(HleArcTan((y << 14) / x) + 0x8000);
+			}
+			return u16(0x4000 - HleArcTan((x << 14) / y));
+		}
+		else {
+			if (x <= 0) {
+				if (-x > -y) return u16(HleArcTan((y << 14) / x) + 0x8000);
+			}
+			else if (x >= -y) {
+				return u16(HleArcTan((y << 14) / x) + 0x10000);
+			}
+			return u16(0xC000 - HleArcTan((x << 14) / y));
+		}
+	}
+
+
+	void HleBgAffineSet(u32 src, u32 dst, u32 count)
+	{
+		for (u32 i = 0; i < count; ++i, src += 20, dst += 16) {
+			s32 origin_x = HleRead<u32>(src);
+			s32 origin_y = HleRead<u32>(src + 4);
+			s32 disp_x = s16(HleRead<u16>(src + 8));
+			s32 disp_y = s16(HleRead<u16>(src + 10));
+			s32 scale_x = s16(HleRead<u16>(src + 12));
+			s32 scale_y = s16(HleRead<u16>(src + 14));
+			u8 angle = HleRead<u16>(src + 16) >> 8;
+			s32 sin = HleSine(angle), cos = HleSine(u8(angle + 64));
+			s32 pa = cos * scale_x >> 14, pb = -(sin * scale_x >> 14);
+			s32 pc = sin * scale_y >> 14, pd = cos * scale_y >> 14;
+			HleWrite<u16>(dst, u16(pa));
+			HleWrite<u16>(dst + 2, u16(pb));
+			HleWrite<u16>(dst + 4, u16(pc));
+			HleWrite<u16>(dst + 6, u16(pd));
+			HleWrite<u32>(dst + 8, u32(origin_x - (pa * disp_x + pb * disp_y)));
+			HleWrite<u32>(dst + 12, u32(origin_y - (pc * disp_x + pd * disp_y)));
+		}
+		cycle += count * affine_set_cycles_per_entry;
+	}
+
+
+	template<std::integral Int>
+	void HleCopy(u32 src, u32 dst, u32 count, bool fill)
+	{
+		src &= ~(sizeof(Int) - 1);
+		dst &= ~(sizeof(Int) - 1);
+		Int fill_value = fill ? HleRead<Int>(src) : 0;
+		for (u32 i = 0; i < count; ++i) {
+			HleWrite<Int>(dst + sizeof(Int) * i, fill ? fill_value : HleRead<Int>(src + sizeof(Int) * i));
+		}
+	}
+
+
+	void HleCpuFastSet(u32 src, u32 dst, u32 control)
+	{
+		u32 count = (control & 0x1F'FFFF) + 7 & ~7; /* always whole blocks of eight words */
+		HleCopy<u32>(src, dst, count, control & 1 << 24);
+		cycle += count * cpu_fast_set_cycles_per_word;
+	}
+
+
+	void HleCpuSet(u32 src, u32 dst, u32 control)
+	{
+		u32 count = control & 0x1F'FFFF;
+		if (control & 1 << 26) HleCopy<u32>(src, dst, count, control & 1 << 24);
+		else                   HleCopy<u16>(src, dst, count, control & 1 << 24);
+		cycle += count * cpu_set_cycles_per_unit;
+	}
+
+
+	bool HleDiv(s32 numerator, s32 denominator)
+	{
+		if (denominator == 0) {
+			return false; /* the BIOS never returns; let it hang */
+		}
+		s64 quotient = s64(numerator) / denominator;
+		s64 remainder = s64(numerator) % denominator;
+		r[0] = u32(quotient);
+		r[1] = u32(remainder);
+		r[3] = u32(quotient < 0 ? -quotient : quotient);
+		cycle += div_cycles;
+		return true;
+	}
+
+
+	void HleHuffUnComp(u32 src, u32 dst)
+	{
+		u32 header = HleRead<u32>(src);
+		uint data_bits = header & 0xF;
+		u32 size = header >> 8;
+		if (data_bits != 4 && data_bits != 8) {
+			return;
+		}
+		u32 tree = src + 4;
+		u32 root = tree + 1;
+		u32 stream = tree + (HleRead<u8>(tree) + 1) * 2;
+		u32 node = root;
+		u32 word = 0;
+		uint word_bits = 0;
+		u32 written = 0;
+		u32 bits_read = 0;
+		while (written < size) {
+			u32 stream_word = HleRead<u32>(stream);
+			stream += 4;
+			for (int bit = 31; bit >= 0 && written < size; --bit) {
+				bool right = stream_word >> bit & 1;
+				u8 node_value = HleRead<u8>(node);
+				u32 child = (node & ~1) + (node_value & 0x3F) * 2 + 2 + right;
+				if (node_value & (right ? 0x40 : 0x80)) {
+					word |= (HleRead<u8>(child) & (1 << data_bits) - 1) << word_bits;
+					word_bits += data_bits;
+					if (word_bits == 32) {
+						HleWrite<u32>(dst + written, word);
+						written += 4;
+						word = word_bits = 0;
+					}
+					node = root;
+				}
+				else {
+					node = child;
+				}
+			}
+			bits_read += 32;
+		}
+		cycle += bits_read * huff_cycles_per_bit;
+	}
+
+
+	void HleObjAffineSet(u32 src, u32 dst, u32 count, u32 offset)
+	{
+		for (u32 i = 0; i < count; ++i, src += 8, dst += 4 * offset) {
+			s32 scale_x = s16(HleRead<u16>(src));
+			s32 scale_y = s16(HleRead<u16>(src + 2));
+			u8 angle = HleRead<u16>(src + 4) >> 8;
+			s32 sin = HleSine(angle), cos = HleSine(u8(angle + 64));
+			HleWrite<u16>(dst, u16(cos * scale_x >> 14));
+			HleWrite<u16>(dst + offset, u16(-(sin * scale_x >> 14)));
+			HleWrite<u16>(dst + 2 * offset, u16(sin * scale_y >> 14));
+			HleWrite<u16>(dst + 3 * offset, u16(cos * scale_y >> 14));
+		}
+		cycle += count * affine_set_cycles_per_entry;
+	}
+
+
+	template<std::integral Int>
+	Int HleRead(u32 addr)
+	{
+		if (u8* ptr = Bus::GetHostPointer(addr)) {
+			Int val;
+			std::memcpy(&val, ptr, sizeof(Int));
+			return val;
+		}
+		return Bus::Peek<Int>(addr);
+	}
+
+
+	s32 HleSine(u8 angle)
+	{
+		/* sin(2 * pi * angle / 256) in 1.14 fixed point, like the table in the BIOS */
+		static const std::array<s16, 256> table = [] {
+			std::array<s16, 256> table;
+			for (uint i = 0; i < 256; ++i) {
+				table[i] = s16(std::lround(std::sin(i * std::numbers::pi / 128) * 0x4000));
+			}
+			return table;
+		}();
+		return table[angle];
+	}
+
+
+	bool HleSoftwareInterrupt(u8 comment)
+	{
+		switch (HleSwi(comment)) {
+		case HleSwi::Div:
+			if (!HleDiv(r[0], r[1])) return false;
+			break;
+
+		case HleSwi::DivArm:
+			if (!HleDiv(r[1], r[0])) return false;
+			break;
+
+		case HleSwi::Sqrt:
+			r[0] = u32(std::sqrt(double(r[0])));
+			cycle += sqrt_cycles;
+			break;
+
+		case HleSwi::ArcTan:
+			r[0] = u32(HleArcTan(s16(r[0])));
+			cycle += arctan_cycles;
+			break;
+
+		case HleSwi::ArcTan2:
+			r[0] = HleArcTan2(s32(r[0]), s32(r[1]));
+			cycle += arctan2_cycles;
+			break;
+
+		case HleSwi::CpuSet:
+			if ((r[0] >> 24 & 0xF) == 0) return false; /* the BIOS refuses to copy from itself */
+			HleCpuSet(r[0], r[1], r[2]);
+			break;
+
+		case HleSwi::CpuFastSet:
+			if ((r[0] >> 24 & 0xF) == 0) return false;
+			HleCpuFastSet(r[0], r[1], r[2]);
+			break;
+
+		case HleSwi::BgAffineSet:
+			HleBgAffineSet(r[0], r[1], r[2]);
+			break;
+
+		case HleSwi::ObjAffineSet:
+			HleObjAffineSet(r[0], r[1], r[2], r[3]);
+			break;
+
+		case HleSwi::LZ77UnCompWram:
+		case HleSwi::LZ77UnCompVram:
+		case HleSwi::RLUnCompWram:
+		case HleSwi::RLUnCompVram:
+			HleUnComp(HleSwi(comment), r[0], r[1]);
+			break;
+
+		case HleSwi::HuffUnComp:
+			HleHuffUnComp(r[0], r[1]);
+			break;
+
+		default:
+			return false;
+		}
+		cycle += swi_base_cycles;
+		return true;
+	}
+
+
+	void HleUnComp(HleSwi swi, u32 src, u32 dst)
+	{
+		/* Decompresses into a host buffer first, then writes it out in bytes (WRAM variants) or halfwords (VRAM variants) */
+		bool vram = swi == HleSwi::LZ77UnCompVram || swi == HleSwi::RLUnCompVram;
+		if (vram) {
+			dst &= ~1;
+		}
+		u32 header = HleRead<u32>(src);
+		u32 size = header >> 8;
+		std::vector<u8> out;
+		out.reserve(size);
+		src += 4;
+		if (swi == HleSwi::LZ77UnCompWram || swi == HleSwi::LZ77UnCompVram) {
+			while (out.size() < size) {
+				u8 flags = HleRead<u8>(src++);
+				for (int i = 0; i < 8 && out.size() < size; ++i, flags <<= 1) {
+					if (flags & 0x80) {
+						u8 b0 = HleRead<u8>(src++);
+						u8 b1 = HleRead<u8>(src++);
+						size_t disp = ((b0 & 0xF) << 8 | b1) + 1;
+						uint len = (b0 >> 4) + 3;
+						for (uint j = 0; j < len && out.size() < size; ++j) {
+							/* The BIOS copies from the destination. Before the start of the output, that is what was there already.
+							   In VRAM, the byte before an odd position is held back until its halfword is complete, so it is not there yet. */
+							bool from_memory = disp > out.size() || vram && disp == 1 && out.size() % 2 == 1;
+							out.push_back(from_memory ? HleRead<u8>(dst + u32(out.size() - disp)) : out[out.size() - disp]);
+						}
+					}
+					else {
+						out.push_back(HleRead<u8>(src++));
+					}
+				}
+			}
+			cycle += size * lz77_cycles_per_byte;
+		}
+		else {
+			while (out.size() < size) {
+				u8 flag = HleRead<u8>(src++);
+				if (flag & 0x80) {
+					u8 data = HleRead<u8>(src++);
+					out.insert(out.end(), std::min<size_t>((flag & 0x7F) + 3, size - out.size()), data);
+				}
+				else {
+					for (uint j = 0; j < (flag & 0x7F) + 1u && out.size() < size; ++j) {
+						out.push_back(HleRead<u8>(src++));
+					}
+				}
+			}
+			cycle += size * rl_cycles_per_byte;
+		}
+
+		if (vram) {
+			/* As with the BIOS, the last byte of an odd size is never written, since its halfword is never completed */
+			for (size_t i = 0; i + 1 < out.size(); i += 2) {
+				HleWrite<u16>(dst + u32(i), u16(out[i] | out[i + 1] << 8));
+			}
+		}
+		else {
+			for (size_t i = 0; i < out.size(); ++i) {
+				HleWrite<u8>(dst + u32(i), out[i]);
+			}
+		}
+	}
+
+
+	template<std::integral Int>
+	void HleWrite(u32 addr, Int data)
+	{
+		if (u8* ptr = Bus::GetHostPointer(addr)) {
+			std::memcpy(ptr, &data, sizeof(Int));
+			if ((addr >> 24) <= 3) {
+				InvalidateBlocks(addr);
+			}
+			else {
+				PPU::MarkDirty(addr, sizeof(Int));
+			}
+		}
+		else {
+			Bus::Write<Int>(addr, data);
+		}
+	}
+
+
+	void SetHleBios(bool enable)
+	{
+		hle_bios = enable;
+	}
+}
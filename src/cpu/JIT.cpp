@@ -0,0 +1,1053 @@
+module;
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+module CPU;
+
+import Bus;
+import Scheduler;
+import UserMessage;
+
+/* Translates cached blocks into x86-64 code. Guest registers and flags stay in 'r' and 'flags', which the host code
+   operates on directly; rbx points at 'r', and the other state the code touches is addressed relative to it.
+   ALU operations, shifts by immediates, branches, and single loads and stores are translated. Loads and stores call
+   Bus::Read/Write, which add the cycles of the access through AddCycles as for the interpreter. All other instructions
+   (multiplies, block transfers, PSR transfers, SWIs, shifts by registers, ...) call their interpreter handler.
+   The code mirrors RunBlock and ExecuteCachedInstr step by step: the deadline and block invalidation are checked
+   before every instruction, exceptions after every call, and opcode fetches are timed the same way. */
+
+namespace CPU
+{
+#if defined(__x86_64__) || defined(_M_X64)
+	constexpr bool jit_host_supported = true;
+#else
+	constexpr bool jit_host_supported = false;
+#endif
+
+	enum HostReg : u8 {
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15
+	};
+
+	enum HostCond : u8 {
+		CC_O, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A, CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G
+	};
+
+	/* Group 1 operations, numbered by their ModRM reg field in the 0x81 encoding */
+	enum HostAluOp : u8 {
+		ALU_ADD, ALU_OR, ALU_ADC, ALU_SBB, ALU_AND, ALU_SUB, ALU_XOR, ALU_CMP
+	};
+
+	/* Group 2 operations, numbered by their ModRM reg field in the 0xC1 encoding */
+	enum HostShiftOp : u8 {
+		SHIFT_ROL, SHIFT_ROR, SHIFT_RCL, SHIFT_RCR, SHIFT_SHL, SHIFT_SHR, SHIFT_SAL, SHIFT_SAR
+	};
+
+	/* Registers with a fixed role in translated code. The callee-saved ones keep their value across calls. */
+	constexpr HostReg reg_state = RBX; /* &r[0] */
+	constexpr HostReg reg_cycle = R12; /* 'cycle'; stored before calls and on exit, and reloaded after calls */
+	constexpr HostReg reg_writeback = R13; /* base register value to write back after a load or store */
+	constexpr HostReg reg_trailing_opcode = R14; /* opcode after the block, when it is read at run time */
+#ifdef _WIN32
+	constexpr HostReg reg_arg0 = RCX;
+	constexpr HostReg reg_arg1 = RDX;
+#else
+	constexpr HostReg reg_arg0 = RDI;
+	constexpr HostReg reg_arg1 = RSI;
+#endif
+
+	constexpr s32 GuestRegOffset(u32 reg) { return s32(4 * reg); }
+
+	class X64Emitter
+	{
+	public:
+		using Label = size_t;
+
+		std::vector<u8> code;
+
+		void Bind(Label label) { label_positions[label] = code.size(); }
+		Label NewLabel() { label_positions.push_back(0); return label_positions.size() - 1; }
+
+		void ResolveLabels()
+		{
+			for (auto [pos, label] : label_uses) {
+				u32 rel = u32(label_positions[label] - (pos + 4));
+				std::memcpy(code.data() + pos, &rel, 4);
+			}
+		}
+
+		/* Operands are 32-bit unless the name says otherwise. "State" operands are memory at [rbx + disp]. */
+		void AddRsp(u8 imm) { Emit8(0x48); Emit8(0x83); EmitModRm(ALU_ADD, RSP); Emit8(imm); }
+		void Add64RegImm(HostReg dst, u8 imm) { EmitRex(true, 0, dst); Emit8(0x83); EmitModRm(ALU_ADD, dst); Emit8(imm); }
+		void Add64RegReg(HostReg dst, HostReg src) { EmitRex(true, src, dst); Emit8(0x01); EmitModRm(src, dst); }
+		void AluRegReg(HostAluOp op, HostReg dst, HostReg src) { EmitRex(false, src, dst); Emit8(op << 3 | 1); EmitModRm(src, dst); }
+		void AluRegState(HostAluOp op, HostReg dst, s32 disp) { EmitRex(false, dst, 0); Emit8(op << 3 | 3); EmitModRmState(dst, disp); }
+		void AluState8Imm(HostAluOp op, s32 disp, u8 imm) { Emit8(0x80); EmitModRmState(op, disp); Emit8(imm); }
+		void BtRegImm(HostReg reg, u8 bit) { EmitRex(false, 0, reg); Emit8(0x0F); Emit8(0xBA); EmitModRm(4, reg); Emit8(bit); }
+		void BtStateImm(s32 disp, u8 bit) { Emit8(0x0F); Emit8(0xBA); EmitModRmState(4, disp); Emit8(bit); }
+		void CallAbsolute(u64 target) { MovReg64Imm(RAX, target); Emit8(0xFF); EmitModRm(2, RAX); }
+		void Cmov(HostCond cond, HostReg dst, HostReg src) { EmitRex(false, dst, src); Emit8(0x0F); Emit8(0x40 | cond); EmitModRm(dst, src); }
+		void Cmp64RegState(HostReg reg, s32 disp) { EmitRex(true, reg, 0); Emit8(0x3B); EmitModRmState(reg, disp); }
+		void Imul(HostReg dst, HostReg src) { EmitRex(false, dst, src); Emit8(0x0F); Emit8(0xAF); EmitModRm(dst, src); }
+		void Jcc(HostCond cond, Label label) { Emit8(0x0F); Emit8(0x80 | cond); EmitLabelUse(label); }
+		void Jmp(Label label) { Emit8(0xE9); EmitLabelUse(label); }
+		void MovRegImm(HostReg dst, u32 imm) { EmitRex(false, 0, dst); Emit8(0xB8 | dst & 7); Emit32(imm); }
+		void MovReg64Imm(HostReg dst, u64 imm) { EmitRex(true, 0, dst); Emit8(0xB8 | dst & 7); Emit64(imm); }
+		void MovRegReg(HostReg dst, HostReg src) { EmitRex(false, src, dst); Emit8(0x89); EmitModRm(src, dst); }
+		void MovRegState(HostReg dst, s32 disp) { EmitRex(false, dst, 0); Emit8(0x8B); EmitModRmState(dst, disp); }
+		void MovReg64State(HostReg dst, s32 disp) { EmitRex(true, dst, 0); Emit8(0x8B); EmitModRmState(dst, disp); }
+		void MovStateImm(s32 disp, u32 imm) { Emit8(0xC7); EmitModRmState(0, disp); Emit32(imm); }
+		void MovState8Imm(s32 disp, u8 imm) { Emit8(0xC6); EmitModRmState(0, disp); Emit8(imm); }
+		void MovStateReg(s32 disp, HostReg src) { EmitRex(false, src, 0); Emit8(0x89); EmitModRmState(src, disp); }
+		void MovState64Reg(s32 disp, HostReg src) { EmitRex(true, src, 0); Emit8(0x89); EmitModRmState(src, disp); }
+		void MovzxRegState8(HostReg dst, s32 disp) { EmitRex(false, dst, 0); Emit8(0x0F); Emit8(0xB6); EmitModRmState(dst, disp); }
+		/* Extensions of al/ax; 'src' must be one of rax, rcx, rdx, rbx */
+		void Movsx8(HostReg dst, HostReg src) { EmitRex(false, dst, src); Emit8(0x0F); Emit8(0xBE); EmitModRm(dst, src); }
+		void Movsx16(HostReg dst, HostReg src) { EmitRex(false, dst, src); Emit8(0x0F); Emit8(0xBF); EmitModRm(dst, src); }
+		void Movzx8(HostReg dst, HostReg src) { EmitRex(false, dst, src); Emit8(0x0F); Emit8(0xB6); EmitModRm(dst, src); }
+		void Movzx16(HostReg dst, HostReg src) { EmitRex(false, dst, src); Emit8(0x0F); Emit8(0xB7); EmitModRm(dst, src); }
+		void Neg(HostReg reg) { EmitRex(false, 0, reg); Emit8(0xF7); EmitModRm(3, reg); }
+		void Not(HostReg reg) { EmitRex(false, 0, reg); Emit8(0xF7); EmitModRm(2, reg); }
+		void Pop(HostReg reg) { EmitRex(false, 0, reg); Emit8(0x58 | reg & 7); }
+		void Push(HostReg reg) { EmitRex(false, 0, reg); Emit8(0x50 | reg & 7); }
+		void Ret() { Emit8(0xC3); }
+		void SetccState(HostCond cond, s32 disp) { Emit8(0x0F); Emit8(0x90 | cond); EmitModRmState(0, disp); }
+		void Shift(HostShiftOp op, HostReg reg, u8 amount) { EmitRex(false, 0, reg); Emit8(0xC1); EmitModRm(op, reg); Emit8(amount); }
+		void SubRsp(u8 imm) { Emit8(0x48); Emit8(0x83); EmitModRm(ALU_SUB, RSP); Emit8(imm); }
+
+		void AluRegImm(HostAluOp op, HostReg dst, u32 imm)
+		{
+			EmitRex(false, 0, dst);
+			if (s32(imm) >= -128 && s32(imm) < 128) {
+				Emit8(0x83);
+				EmitModRm(op, dst);
+				Emit8(u8(imm));
+			}
+			else {
+				Emit8(0x81);
+				EmitModRm(op, dst);
+				Emit32(imm);
+			}
+		}
+
+		void AluStateImm(HostAluOp op, s32 disp, u32 imm)
+		{
+			if (s32(imm) >= -128 && s32(imm) < 128) {
+				Emit8(0x83);
+				EmitModRmState(op, disp);
+				Emit8(u8(imm));
+			}
+			else {
+				Emit8(0x81);
+				EmitModRmState(op, disp);
+				Emit32(imm);
+			}
+		}
+
+		template<typename Ret, typename... Args>
+		void CallHost(Ret(*func)(Args...))
+		{
+			CallAbsolute(reinterpret_cast<u64>(func));
+		}
+
+	private:
+		std::vector<size_t> label_positions;
+		std::vector<std::pair<size_t, Label>> label_uses; /* positions of rel32 fields, and their targets */
+
+		void Emit8(u8 value) { code.push_back(value); }
+		void Emit32(u32 value) { for (int i = 0; i < 32; i += 8) code.push_back(u8(value >> i)); }
+		void Emit64(u64 value) { for (int i = 0; i < 64; i += 8) code.push_back(u8(value >> i)); }
+		void EmitLabelUse(Label label) { label_uses.emplace_back(code.size(), label); Emit32(0); }
+		void EmitModRm(u8 reg, u8 rm) { Emit8(0xC0 | (reg & 7) << 3 | rm & 7); }
+
+		/* 'reg' and 'rm' are the full register numbers going into the ModRM reg and rm (or opcode) fields */
+		void EmitRex(bool w, u8 reg, u8 rm)
+		{
+			u8 rex = 0x40 | w << 3 | (reg >> 3) << 2 | rm >> 3;
+			if (rex != 0x40) {
+				Emit8(rex);
+			}
+		}
+
+		void EmitModRmState(u8 reg, s32 disp)
+		{
+			if (disp >= -128 && disp < 128) {
+				Emit8(0x40 | (reg & 7) << 3 | RBX);
+				Emit8(u8(disp));
+			}
+			else {
+				Emit8(0x80 | (reg & 7) << 3 | RBX);
+				Emit32(u32(disp));
+			}
+		}
+	};
+
+
+	template<ExecutionState state>
+	class BlockTranslator : public X64Emitter
+	{
+	public:
+		using Opcode = CachedOpcode<state>;
+		static constexpr u32 instr_size = sizeof(Opcode);
+
+		BlockTranslator(const Block<state>& block, u32 addr) : block(block), block_addr(addr) {}
+
+		void Translate()
+		{
+			/* Four pushes and 40 bytes leave the stack 16-byte aligned at calls, with the Win64 shadow space reserved */
+			Push(RBX);
+			Push(R12);
+			Push(R13);
+			Push(R14);
+			SubRsp(40);
+			MovReg64Imm(reg_state, reinterpret_cast<u64>(r.data()));
+			MovReg64State(reg_cycle, jit_offsets.cycle);
+
+			exception_exit = NewLabel();
+			flushed_exit = NewLabel();
+			epilogue = NewLabel();
+
+			/* The opcode after the block is read into the pipeline when the block is left at its end. Within the region
+			   of the block, it is covered by the block's registration for invalidation, and can be read now. */
+			const auto& instrs = block.instrs;
+			u32 trailing_addr = block_addr + u32(instrs.size()) * instr_size;
+			std::optional<Opcode> trailing_opcode;
+			if (trailing_addr >> 24 == block_addr >> 24 && IsCacheable(trailing_addr)) {
+				trailing_opcode = Bus::Peek<Opcode>(trailing_addr);
+			}
+
+			for (size_t i = 0; i < instrs.size(); ++i) {
+				instr_addr = block_addr + u32(i) * instr_size;
+				if (i > 0) {
+					Label exit = AddExit(instrs[i].opcode);
+					Cmp64RegState(reg_cycle, jit_offsets.next_deadline);
+					Jcc(CC_AE, exit);
+					if (may_invalidate) {
+						AluState8Imm(ALU_CMP, jit_offsets.block_invalidated, 0);
+						Jcc(CC_NE, exit);
+					}
+				}
+				may_invalidate = false;
+				if (i == instrs.size() - 1 && !trailing_opcode) {
+					/* Read before the last instruction can overwrite it, as in RunBlock */
+					MovRegImm(reg_arg0, trailing_addr);
+					CallHost(&Bus::Peek<Opcode>);
+					if constexpr (state == ExecutionState::THUMB) Movzx16(RAX, RAX);
+					MovRegReg(reg_trailing_opcode, RAX);
+				}
+				if constexpr (state == ExecutionState::ARM) {
+					TranslateArm(instrs[i]);
+				}
+				else {
+					TranslateThumb(instrs[i]);
+				}
+				EmitFetchTiming(instrs[i]);
+			}
+			instr_addr = trailing_addr;
+			Jmp(AddExit(trailing_opcode));
+
+			for (const Exit& exit : exits) {
+				Bind(exit.label);
+				if (exit.pending_sequential_addr) {
+					MovStateImm(jit_offsets.next_sequential_addr, *exit.pending_sequential_addr);
+				}
+				MovStateImm(GuestRegOffset(15), exit.guest_pc);
+				if (exit.prefetched_opcode) {
+					MovRegImm(RAX, *exit.prefetched_opcode);
+				}
+				else {
+					MovRegReg(RAX, reg_trailing_opcode);
+				}
+				Jmp(epilogue);
+			}
+			Bind(exception_exit);
+			CallHost(&HandleJitException);
+			MovReg64State(reg_cycle, jit_offsets.cycle);
+			Bind(flushed_exit);
+			MovReg64Imm(RAX, u64(-1));
+			Bind(epilogue);
+			MovState64Reg(jit_offsets.cycle, reg_cycle);
+			AddRsp(40);
+			Pop(R14);
+			Pop(R13);
+			Pop(R12);
+			Pop(RBX);
+			Ret();
+			ResolveLabels();
+		}
+
+	private:
+		/* Leaves the block before the instruction at 'instr_addr', and returns the opcode to refill the pipeline with */
+		struct Exit {
+			Label label;
+			std::optional<u32> pending_sequential_addr;
+			u32 guest_pc;
+			std::optional<Opcode> prefetched_opcode; /* in reg_trailing_opcode if not known */
+		};
+
+		const Block<state>& block;
+		u32 block_addr;
+		u32 instr_addr = 0;
+		/* Bus::next_addr_for_sequential_access after the last fetch, if not yet stored. Stores are deferred
+		   until something can read it (calls and exits), so that blocks without calls never touch it. */
+		std::optional<u32> pending_sequential_addr;
+		bool called_since_fetch = true; /* whether the bus may have been accessed since the last opcode fetch */
+		bool may_invalidate = false; /* whether the last instruction may have written memory */
+		Label exception_exit = 0, flushed_exit = 0, epilogue = 0;
+		std::vector<Exit> exits;
+
+		/* The value of r15 while the instruction is executed, which is also the address of the opcode fetched after it */
+		u32 GuestPc() const { return instr_addr + 2 * instr_size; }
+
+		Label AddExit(std::optional<Opcode> prefetched_opcode)
+		{
+			Label label = NewLabel();
+			exits.push_back({ label, pending_sequential_addr, GuestPc(), prefetched_opcode });
+			return label;
+		}
+
+		void EmitArithmeticFlags(bool subtraction, HostReg result)
+		{
+			/* x86 sets CF on borrow, while ARM clears C */
+			SetccState(subtraction ? CC_AE : CC_B, jit_offsets.carry);
+			SetccState(CC_O, jit_offsets.overflow);
+			EmitNZ(result);
+		}
+
+		void EmitCondition(u32 cond, Label skip)
+		{
+			/* Jumps to 'skip' if 'cond' does not hold, as CheckCondition */
+			auto TestN = [&] { AluStateImm(ALU_CMP, jit_offsets.n_result, 0); }; /* SF = N */
+			auto TestZ = [&] { AluStateImm(ALU_CMP, jit_offsets.z_result, 0); }; /* ZF = Z */
+			auto TestC = [&] { AluState8Imm(ALU_CMP, jit_offsets.carry, 0); }; /* ZF = !C */
+			auto TestV = [&] { AluState8Imm(ALU_CMP, jit_offsets.overflow, 0); }; /* ZF = !V */
+			auto TestNEqualsV = [&] { /* ZF = (N == V) */
+				MovRegState(RAX, jit_offsets.n_result);
+				Shift(SHIFT_SHR, RAX, 31);
+				MovzxRegState8(RCX, jit_offsets.overflow);
+				AluRegReg(ALU_CMP, RAX, RCX);
+			};
+			Label run = NewLabel();
+			switch (cond) {
+			case  0: TestZ(); Jcc(CC_NE, skip); break;
+			case  1: TestZ(); Jcc(CC_E, skip); break;
+			case  2: TestC(); Jcc(CC_E, skip); break;
+			case  3: TestC(); Jcc(CC_NE, skip); break;
+			case  4: TestN(); Jcc(CC_NS, skip); break;
+			case  5: TestN(); Jcc(CC_S, skip); break;
+			case  6: TestV(); Jcc(CC_E, skip); break;
+			case  7: TestV(); Jcc(CC_NE, skip); break;
+			case  8: TestC(); Jcc(CC_E, skip); TestZ(); Jcc(CC_E, skip); break;
+			case  9: TestC(); Jcc(CC_E, run); TestZ(); Jcc(CC_NE, skip); break;
+			case 10: TestNEqualsV(); Jcc(CC_NE, skip); break;
+			case 11: TestNEqualsV(); Jcc(CC_E, skip); break;
+			case 12: TestZ(); Jcc(CC_E, skip); TestNEqualsV(); Jcc(CC_NE, skip); break;
+			case 13: TestZ(); Jcc(CC_E, run); TestNEqualsV(); Jcc(CC_E, skip); break;
+			case 14: break;
+			case 15: Jmp(skip); break;
+			default: std::unreachable();
+			}
+			Bind(run);
+		}
+
+		void EmitFetchTiming(const CachedInstrType<state>& instr)
+		{
+			/* As at the end of ExecuteCachedInstr */
+			u32 fetch_addr = GuestPc();
+			if (instr.cycles[0] == 0) {
+				PrepareCall();
+				MovRegImm(reg_arg0, fetch_addr);
+				CallHost(&GetJitPrefetchedFetchCycles<Opcode>);
+				MovReg64State(reg_cycle, jit_offsets.cycle);
+				Add64RegReg(reg_cycle, RAX);
+			}
+			else {
+				if (!called_since_fetch || instr.cycles[0] == instr.cycles[1]) {
+					Add64RegImm(reg_cycle, instr.cycles[!called_since_fetch]);
+				}
+				else {
+					AluStateImm(ALU_CMP, jit_offsets.next_sequential_addr, fetch_addr);
+					MovRegImm(RAX, instr.cycles[0]);
+					MovRegImm(RCX, instr.cycles[1]);
+					Cmov(CC_E, RAX, RCX);
+					Add64RegReg(reg_cycle, RAX);
+				}
+				pending_sequential_addr = fetch_addr + instr_size;
+			}
+			called_since_fetch = false;
+		}
+
+		void EmitFlushedExit()
+		{
+			/* For branches; the pipeline is flushed when the code returns */
+			if (pending_sequential_addr) {
+				MovStateImm(jit_offsets.next_sequential_addr, *pending_sequential_addr);
+			}
+			Jmp(flushed_exit);
+		}
+
+		void EmitNZ(HostReg result)
+		{
+			MovStateReg(jit_offsets.n_result, result);
+			MovStateReg(jit_offsets.z_result, result);
+		}
+
+		void EmitShiftImm(u32 type, u32 amount, bool set_carry)
+		{
+			/* Shifts ecx as Shift(u32) does for an immediate amount. Amounts of 0 stand for LSR#32, ASR#32 and RRX. */
+			switch (type) {
+			case 0: /* LSL; #0 leaves the value and carry alone */
+				if (amount == 0) return;
+				Shift(SHIFT_SHL, RCX, u8(amount));
+				break;
+			case 1: /* LSR */
+				if (amount == 0) {
+					if (set_carry) {
+						BtRegImm(RCX, 31);
+						SetccState(CC_B, jit_offsets.carry);
+					}
+					MovRegImm(RCX, 0);
+					return;
+				}
+				Shift(SHIFT_SHR, RCX, u8(amount));
+				break;
+			case 2: /* ASR */
+				if (amount == 0) {
+					Shift(SHIFT_SAR, RCX, 31);
+					BtRegImm(RCX, 31);
+				}
+				else {
+					Shift(SHIFT_SAR, RCX, u8(amount));
+				}
+				break;
+			case 3: /* ROR */
+				if (amount == 0) {
+					BtStateImm(jit_offsets.carry, 0);
+					Shift(SHIFT_RCR, RCX, 1);
+				}
+				else {
+					Shift(SHIFT_ROR, RCX, u8(amount));
+				}
+				break;
+			default:
+				std::unreachable();
+			}
+			if (set_carry) {
+				SetccState(CC_B, jit_offsets.carry);
+			}
+		}
+
+		template<std::integral Int>
+		void EmitLoadCall(u32 rd)
+		{
+			/* Loads from the address in eax into rd */
+			MovRegReg(reg_arg0, RAX);
+			CallHost(&Bus::Read<Int>);
+			if constexpr (sizeof(Int) == 1) std::signed_integral<Int> ? Movsx8(RAX, RAX) : Movzx8(RAX, RAX);
+			if constexpr (sizeof(Int) == 2) std::signed_integral<Int> ? Movsx16(RAX, RAX) : Movzx16(RAX, RAX);
+			MovStateReg(GuestRegOffset(rd), RAX);
+		}
+
+		template<std::integral Int>
+		void EmitStoreCall(u32 rd)
+		{
+			/* Stores rd to the address in eax */
+			LoadGuestReg(reg_arg1, rd, 4); /* r15 is stored as the address of the instruction plus 12 */
+			MovRegReg(reg_arg0, RAX);
+			CallHost(&Bus::Write<Int>);
+			may_invalidate = true;
+		}
+
+		void AfterCall(bool may_flush)
+		{
+			MovReg64State(reg_cycle, jit_offsets.cycle);
+			AluState8Imm(ALU_CMP, jit_offsets.exception_has_occurred, 0);
+			Jcc(CC_NE, exception_exit);
+			if (may_flush) {
+				AluStateImm(ALU_CMP, jit_offsets.pipeline_step, 2);
+				Jcc(CC_B, flushed_exit);
+			}
+		}
+
+		void LoadGuestReg(HostReg dst, u32 reg, u32 pc_offset = 0)
+		{
+			if (reg == 15) {
+				MovRegImm(dst, GuestPc() + pc_offset);
+			}
+			else {
+				MovRegState(dst, GuestRegOffset(reg));
+			}
+		}
+
+		void PrepareCall()
+		{
+			/* Emitted ahead of the condition check of an instruction that makes a call, so that the state seen by
+			   the callee (and on any exit after it) is the same whether the instruction is executed or not */
+			if (pending_sequential_addr) {
+				MovStateImm(jit_offsets.next_sequential_addr, *pending_sequential_addr);
+				pending_sequential_addr = std::nullopt;
+			}
+			MovState64Reg(jit_offsets.cycle, reg_cycle);
+			MovStateImm(GuestRegOffset(15), GuestPc());
+			called_since_fetch = true;
+		}
+
+		void TranslateFallback(const CachedInstrType<state>& instr)
+		{
+			PrepareCall();
+			Label skip = NewLabel();
+			if constexpr (state == ExecutionState::ARM) {
+				EmitCondition(instr.opcode >> 28, skip);
+			}
+			MovRegImm(reg_arg0, instr.opcode);
+			CallAbsolute(reinterpret_cast<u64>(instr.handler));
+			AfterCall(true);
+			Bind(skip);
+			may_invalidate = true;
+		}
+
+		void TranslateArm(const ArmCachedInstr& instr)
+		{
+			u32 opcode = instr.opcode;
+			u32 hi = opcode >> 20 & 0xFF;
+			u32 rd = opcode >> 12 & 0xF;
+			u32 rn = opcode >> 16 & 0xF;
+			if ((opcode & 0x0E00'0000) == 0x0A00'0000) {
+				TranslateArmBranch(opcode);
+			}
+			else if ((opcode & 0x0C00'0000) == 0
+				&& (opcode & 0x0200'0000 || !(opcode & 0x10)) /* not a shift by register, multiply, BX, or halfword transfer */
+				&& (hi & 0x19) != 0x10 /* not TST/TEQ/CMP/CMN without S, which encode PSR transfers */
+				&& rd != 15) {
+				TranslateArmDataProcessing(opcode);
+			}
+			else if ((opcode & 0x0C00'0000) == 0x0400'0000
+				&& !(opcode & 0x0200'0000 && opcode & 0x10) /* not a register offset shifted by a register */
+				&& !(opcode & 1 << 20 && rd == 15)
+				&& !((opcode & 1 << 21 || !(opcode & 1 << 24)) && rn == 15)) {
+				TranslateArmSingleDataTransfer(opcode);
+			}
+			else {
+				TranslateFallback(instr);
+			}
+		}
+
+		void TranslateArmBranch(u32 opcode)
+		{
+			Label skip = NewLabel();
+			EmitCondition(opcode >> 28, skip);
+			s32 offset = SignExtend<s32, 26>((opcode & 0xFF'FFFF) << 2);
+			if (opcode & 1 << 24) { /* BL */
+				MovStateImm(GuestRegOffset(14), GuestPc() - 4);
+			}
+			MovStateImm(GuestRegOffset(15), GuestPc() + offset);
+			EmitFlushedExit();
+			Bind(skip);
+		}
+
+		void TranslateArmDataProcessing(u32 opcode)
+		{
+			/* As DataProcessing: op1 in eax, op2 in ecx, the result in eax */
+			using enum ArmDataProcessingInstruction;
+			constexpr std::array instr_by_opcode = {
+				AND, EOR, SUB, RSB, ADD, ADC, SBC, RSC, TST, TEQ, CMP, CMN, ORR, MOV, BIC, MVN
+			};
+			ArmDataProcessingInstruction instr = instr_by_opcode[opcode >> 21 & 0xF];
+			bool reg_or_imm = opcode >> 25 & 1;
+			bool set_conds = opcode >> 20 & 1;
+			u32 rd = opcode >> 12 & 0xF;
+			u32 rn = opcode >> 16 & 0xF;
+
+			Label skip = NewLabel();
+			EmitCondition(opcode >> 28, skip);
+			if (!OneOf(instr, MOV, MVN)) {
+				LoadGuestReg(RAX, rn, reg_or_imm ? 0 : 4);
+			}
+			if (reg_or_imm) {
+				u32 imm = opcode & 0xFF;
+				u32 rot = opcode >> 7 & 0x1E;
+				if (set_conds && rot != 0) {
+					MovState8Imm(jit_offsets.carry, imm >> (rot - 1) & 1);
+				}
+				MovRegImm(RCX, std::rotr(imm, rot));
+			}
+			else {
+				LoadGuestReg(RCX, opcode & 0xF);
+				EmitShiftImm(opcode >> 5 & 3, opcode >> 7 & 0x1F, set_conds);
+			}
+
+			switch (instr) {
+			case AND: case TST: AluRegReg(ALU_AND, RAX, RCX); break;
+			case EOR: case TEQ: AluRegReg(ALU_XOR, RAX, RCX); break;
+			case ORR: AluRegReg(ALU_OR, RAX, RCX); break;
+			case BIC: Not(RCX); AluRegReg(ALU_AND, RAX, RCX); break;
+			case MOV: MovRegReg(RAX, RCX); break;
+			case MVN: MovRegReg(RAX, RCX); Not(RAX); break;
+			case ADD: case CMN: AluRegReg(ALU_ADD, RAX, RCX); break;
+			case SUB: case CMP: AluRegReg(ALU_SUB, RAX, RCX); break;
+			case RSB: AluRegReg(ALU_SUB, RCX, RAX); MovRegReg(RAX, RCX); break;
+			case ADC: /* CF = C */
+				BtStateImm(jit_offsets.carry, 0);
+				AluRegReg(ALU_ADC, RAX, RCX);
+				break;
+			case SBC: /* CF = !C */
+				AluState8Imm(ALU_CMP, jit_offsets.carry, 1);
+				AluRegReg(ALU_SBB, RAX, RCX);
+				break;
+			case RSC:
+				AluState8Imm(ALU_CMP, jit_offsets.carry, 1);
+				AluRegReg(ALU_SBB, RCX, RAX);
+				MovRegReg(RAX, RCX);
+				break;
+			default:
+				std::unreachable();
+			}
+
+			if (set_conds) {
+				if (OneOf(instr, ADC, ADD, CMN, CMP, RSB, RSC, SBC, SUB)) {
+					EmitArithmeticFlags(OneOf(instr, CMP, RSB, RSC, SBC, SUB), RAX);
+				}
+				else {
+					EmitNZ(RAX);
+				}
+			}
+			if (!OneOf(instr, CMN, CMP, TEQ, TST)) {
+				MovStateReg(GuestRegOffset(rd), RAX);
+			}
+			Bind(skip);
+		}
+
+		void TranslateArmSingleDataTransfer(u32 opcode)
+		{
+			/* As SingleDataTransfer; the address is computed in eax, and the written back base in reg_writeback */
+			u32 rd = opcode >> 12 & 0xF;
+			u32 rn = opcode >> 16 & 0xF;
+			bool load_or_store = opcode >> 20 & 1;
+			bool writeback = opcode >> 21 & 1;
+			bool byte_or_word = opcode >> 22 & 1;
+			bool up_or_down = opcode >> 23 & 1;
+			bool p = opcode >> 24 & 1;
+			bool reg_or_imm = opcode >> 25 & 1;
+
+			PrepareCall();
+			Label skip = NewLabel();
+			EmitCondition(opcode >> 28, skip);
+			u32 imm_offset = up_or_down ? opcode & 0xFFF : -(opcode & 0xFFF);
+			if (reg_or_imm) {
+				/* Shift(opcode) is called with set_conds, so a register offset updates the carry */
+				LoadGuestReg(RCX, opcode & 0xF);
+				EmitShiftImm(opcode >> 5 & 3, opcode >> 7 & 0x1F, true);
+				if (!up_or_down) {
+					Neg(RCX);
+				}
+			}
+			auto AddOffset = [&](HostReg reg) {
+				if (reg_or_imm)           AluRegReg(ALU_ADD, reg, RCX);
+				else if (imm_offset != 0) AluRegImm(ALU_ADD, reg, imm_offset);
+			};
+			LoadGuestReg(RAX, rn);
+			if (p) {
+				AddOffset(RAX);
+			}
+			if (writeback || !p) {
+				MovRegReg(reg_writeback, RAX);
+				if (!p) {
+					AddOffset(reg_writeback);
+				}
+			}
+			if (load_or_store) {
+				byte_or_word ? EmitLoadCall<u8>(rd) : EmitLoadCall<u32>(rd);
+			}
+			else {
+				byte_or_word ? EmitStoreCall<u8>(rd) : EmitStoreCall<u32>(rd);
+			}
+			if (writeback || !p) {
+				MovStateReg(GuestRegOffset(rn), reg_writeback); /* after the load, as in SingleDataTransfer */
+			}
+			AfterCall(false);
+			Bind(skip);
+		}
+
+		void TranslateThumb(const ThumbCachedInstr& instr)
+		{
+			u16 opcode = instr.opcode;
+			switch (opcode >> 12) {
+			case 0x0: case 0x1:
+				if ((opcode & 0x1800) == 0x1800) { /* Format 2: ADD, SUB */
+					bool sub = opcode >> 9 & 1;
+					u32 operand = opcode >> 6 & 7;
+					LoadGuestReg(RAX, opcode >> 3 & 7);
+					if (opcode & 1 << 10) {
+						AluRegImm(sub ? ALU_SUB : ALU_ADD, RAX, operand);
+					}
+					else {
+						LoadGuestReg(RCX, operand);
+						AluRegReg(sub ? ALU_SUB : ALU_ADD, RAX, RCX);
+					}
+					EmitArithmeticFlags(sub, RAX);
+					MovStateReg(GuestRegOffset(opcode & 7), RAX);
+				}
+				else { /* Format 1: LSL, LSR, ASR */
+					LoadGuestReg(RCX, opcode >> 3 & 7);
+					EmitShiftImm(opcode >> 11 & 3, opcode >> 6 & 0x1F, true);
+					MovStateReg(GuestRegOffset(opcode & 7), RCX);
+					EmitNZ(RCX);
+				}
+				return;
+
+			case 0x2: case 0x3: { /* Format 3: MOV, CMP, ADD, SUB */
+				u32 rd = opcode >> 8 & 7;
+				u32 imm = opcode & 0xFF;
+				u32 op = opcode >> 11 & 3;
+				if (op == 0) {
+					MovStateImm(GuestRegOffset(rd), imm);
+					MovStateImm(jit_offsets.n_result, imm);
+					MovStateImm(jit_offsets.z_result, imm);
+					return;
+				}
+				LoadGuestReg(RAX, rd);
+				AluRegImm(op == 2 ? ALU_ADD : ALU_SUB, RAX, imm);
+				EmitArithmeticFlags(op != 2, RAX);
+				if (op != 1) {
+					MovStateReg(GuestRegOffset(rd), RAX);
+				}
+				return;
+			}
+
+			case 0x4:
+				if (opcode & 0x800) { /* Format 6: LDR Rd,[PC,#nn] */
+					PrepareCall();
+					MovRegImm(RAX, (GuestPc() & ~2) + ((opcode & 0xFF) << 2));
+					EmitLoadCall<u32>(opcode >> 8 & 7);
+					AfterCall(false);
+				}
+				else if (opcode & 0x400) {
+					TranslateThumbHiReg(instr);
+				}
+				else {
+					TranslateThumbAlu(instr);
+				}
+				return;
+
+			case 0x5: { /* Formats 7 and 8: loads and stores with register offset */
+				u32 rd = opcode & 7;
+				PrepareCall();
+				LoadGuestReg(RAX, opcode >> 3 & 7);
+				LoadGuestReg(RCX, opcode >> 6 & 7);
+				AluRegReg(ALU_ADD, RAX, RCX);
+				if (opcode & 0x200) {
+					switch (opcode >> 10 & 3) {
+					case 0: EmitStoreCall<s16>(rd); break;
+					case 1: EmitLoadCall<s8>(rd); break;
+					case 2: EmitLoadCall<u16>(rd); break;
+					case 3: EmitLoadCall<s16>(rd); break;
+					}
+				}
+				else {
+					switch (opcode >> 10 & 3) {
+					case 0: EmitStoreCall<u32>(rd); break;
+					case 1: EmitStoreCall<u8>(rd); break;
+					case 2: EmitLoadCall<u32>(rd); break;
+					case 3: EmitLoadCall<u8>(rd); break;
+					}
+				}
+				AfterCall(false);
+				return;
+			}
+
+			case 0x6: case 0x7: case 0x8: case 0x9: { /* Formats 9-11: loads and stores with immediate offset */
+				bool load_or_store = opcode >> 11 & 1;
+				u32 rd, offset;
+				PrepareCall();
+				if (opcode >> 12 == 0x9) { /* SP-relative */
+					rd = opcode >> 8 & 7;
+					offset = (opcode & 0xFF) << 2;
+					LoadGuestReg(RAX, 13);
+				}
+				else {
+					rd = opcode & 7;
+					offset = opcode >> 12 == 0x6 ? opcode >> 4 & 0x7C : opcode >> 12 == 0x7 ? opcode >> 6 & 0x1F : opcode >> 5 & 0x3E;
+					LoadGuestReg(RAX, opcode >> 3 & 7);
+				}
+				if (offset != 0) {
+					AluRegImm(ALU_ADD, RAX, offset);
+				}
+				switch (opcode >> 12) {
+				case 0x7: load_or_store ? EmitLoadCall<u8>(rd) : EmitStoreCall<u8>(rd); break;
+				case 0x8: load_or_store ? EmitLoadCall<u16>(rd) : EmitStoreCall<u16>(rd); break;
+				default: load_or_store ? EmitLoadCall<u32>(rd) : EmitStoreCall<u32>(rd); break;
+				}
+				AfterCall(false);
+				return;
+			}
+
+			case 0xA: { /* Format 12: ADD Rd,PC,#nn; ADD Rd,SP,#nn */
+				u32 rd = opcode >> 8 & 7;
+				u32 offset = (opcode & 0xFF) << 2;
+				if (opcode & 0x800) {
+					LoadGuestReg(RAX, 13);
+					AluRegImm(ALU_ADD, RAX, offset);
+					MovStateReg(GuestRegOffset(rd), RAX);
+				}
+				else {
+					MovStateImm(GuestRegOffset(rd), (GuestPc() & ~2) + offset);
+				}
+				return;
+			}
+
+			case 0xB:
+				if (opcode & 0x400) { /* Format 14: PUSH, POP */
+					TranslateFallback(instr);
+				}
+				else { /* Format 13: ADD SP,#nn */
+					u32 offset = (opcode & 0x7F) << 2;
+					AluStateImm(opcode & 0x80 ? ALU_SUB : ALU_ADD, GuestRegOffset(13), offset);
+				}
+				return;
+
+			case 0xD:
+				if ((opcode & 0xF00) == 0xF00) { /* Format 17: SWI */
+					TranslateFallback(instr);
+				}
+				else { /* Format 16: conditional branch */
+					Label skip = NewLabel();
+					EmitCondition(opcode >> 8 & 0xF, skip);
+					MovStateImm(GuestRegOffset(15), GuestPc() + SignExtend<s32, 9>(opcode << 1 & 0x1FE));
+					EmitFlushedExit();
+					Bind(skip);
+				}
+				return;
+
+			case 0xE: /* Format 18: B */
+				MovStateImm(GuestRegOffset(15), GuestPc() + SignExtend<s32, 12>(opcode << 1 & 0xFFE));
+				EmitFlushedExit();
+				return;
+
+			case 0xF: /* Format 19: BL */
+				if (opcode & 0x800) {
+					MovRegState(RAX, GuestRegOffset(14));
+					AluRegImm(ALU_ADD, RAX, (opcode & 0x7FF) << 1);
+					MovStateReg(GuestRegOffset(15), RAX);
+					MovStateImm(GuestRegOffset(14), (instr_addr + 2) | 1);
+					EmitFlushedExit();
+				}
+				else {
+					MovStateImm(GuestRegOffset(14), GuestPc() + SignExtend<s32, 23>((opcode & 0x7FF) << 12));
+				}
+				return;
+
+			default: /* Format 15: LDMIA, STMIA */
+				TranslateFallback(instr);
+				return;
+			}
+		}
+
+		void TranslateThumbAlu(const ThumbCachedInstr& instr)
+		{
+			/* As AluOperation, with the exception of shifts by registers: op1 in eax, op2 in ecx, the result in eax */
+			using enum ThumbAluInstruction;
+			constexpr std::array instr_by_opcode = {
+				AND, EOR, LSL, LSR, ASR, ADC, SBC, ROR, TST, NEG, CMP, CMN, ORR, MUL, BIC, MVN
+			};
+			ThumbAluInstruction alu_instr = instr_by_opcode[instr.opcode >> 6 & 0xF];
+			if (OneOf(alu_instr, ASR, LSL, LSR, ROR)) {
+				TranslateFallback(instr);
+				return;
+			}
+			u32 rd = instr.opcode & 7;
+			LoadGuestReg(RAX, rd);
+			LoadGuestReg(RCX, instr.opcode >> 3 & 7);
+			switch (alu_instr) {
+			case AND: case TST: AluRegReg(ALU_AND, RAX, RCX); break;
+			case EOR: AluRegReg(ALU_XOR, RAX, RCX); break;
+			case ORR: AluRegReg(ALU_OR, RAX, RCX); break;
+			case BIC: Not(RCX); AluRegReg(ALU_AND, RAX, RCX); break;
+			case MVN: MovRegReg(RAX, RCX); Not(RAX); break;
+			case ADC: BtStateImm(jit_offsets.carry, 0); AluRegReg(ALU_ADC, RAX, RCX); break;
+			case SBC: AluState8Imm(ALU_CMP, jit_offsets.carry, 1); AluRegReg(ALU_SBB, RAX, RCX); break;
+			case CMN: AluRegReg(ALU_ADD, RAX, RCX); break;
+			case CMP: AluRegReg(ALU_SUB, RAX, RCX); break;
+			case NEG: MovRegReg(RAX, RCX); Neg(RAX); break; /* CF = (op2 != 0), so C = !CF as for subtractions */
+			case MUL: Imul(RAX, RCX); MovState8Imm(jit_offsets.carry, 0); break;
+			default: std::unreachable();
+			}
+			if (OneOf(alu_instr, ADC, CMN)) {
+				EmitArithmeticFlags(false, RAX);
+			}
+			else if (OneOf(alu_instr, CMP, NEG, SBC)) {
+				EmitArithmeticFlags(true, RAX);
+			}
+			else {
+				EmitNZ(RAX);
+			}
+			if (!OneOf(alu_instr, CMN, CMP, TST)) {
+				MovStateReg(GuestRegOffset(rd), RAX);
+			}
+		}
+
+		void TranslateThumbHiReg(const ThumbCachedInstr& instr)
+		{
+			/* As HiReg; ADD and MOV to r15, and BX, end the block and call the handler */
+			u16 opcode = instr.opcode;
+			u32 op = opcode >> 8 & 3;
+			u32 rs = (opcode >> 3 & 7) | (opcode >> 3 & 8);
+			u32 rd = (opcode & 7) | (opcode >> 4 & 8);
+			if (op == 3 || op != 1 && rd == 15) {
+				TranslateFallback(instr);
+				return;
+			}
+			if (rs == 15) {
+				MovRegImm(RCX, GuestPc() & ~1);
+			}
+			else {
+				MovRegState(RCX, GuestRegOffset(rs));
+			}
+			switch (op) {
+			case 0: /* ADD */
+				LoadGuestReg(RAX, rd);
+				AluRegReg(ALU_ADD, RAX, RCX);
+				MovStateReg(GuestRegOffset(rd), RAX);
+				break;
+			case 1: /* CMP */
+				LoadGuestReg(RAX, rd);
+				AluRegReg(ALU_SUB, RAX, RCX);
+				EmitArithmeticFlags(true, RAX);
+				break;
+			case 2: /* MOV */
+				MovStateReg(GuestRegOffset(rd), RCX);
+				break;
+			}
+		}
+	};
+
+
+	template<ExecutionState state>
+	bool CompileBlock(Block<state>& block, u32 addr)
+	{
+		BlockTranslator<state> translator(block, addr);
+		translator.Translate();
+		const auto& code = translator.code;
+		if (code.size() > jit_code_buffer_capacity - jit_code_size) {
+			ResetJitCode();
+		}
+		u8* code_ptr = jit_code_buffer + jit_code_size;
+		if (!SetJitCodeWritable(code_ptr, code.size(), true)) {
+			DisableJit("Failed to make JIT code writable; using the cached interpreter.");
+			return false;
+		}
+		std::memcpy(code_ptr, code.data(), code.size());
+		if (!SetJitCodeWritable(code_ptr, code.size(), false)) {
+			DisableJit("Failed to make JIT code executable; using the cached interpreter.");
+			return false;
+		}
+		jit_code_size += (code.size() + 15) & ~15;
+		block.jit_code = reinterpret_cast<JitCode>(code_ptr);
+		return true;
+	}
+
+
+	void DisableJit(const char* reason)
+	{
+		UserMessage::Show(reason, UserMessage::Type::Warning);
+		backend = Backend::CachedInterpreter;
+	}
+
+
+	bool EnableJit()
+	{
+		if (!jit_host_supported) {
+			UserMessage::Show("The JIT is only available on x86-64 hosts; using the cached interpreter.", UserMessage::Type::Warning);
+			return false;
+		}
+		if (jit_code_buffer) {
+			return true;
+		}
+		/* Translated code addresses all state relative to 'r', with 32-bit displacements */
+		auto Offset = [](const void* ptr, s32& offset) {
+			s64 diff = s64(reinterpret_cast<uintptr_t>(ptr) - reinterpret_cast<uintptr_t>(r.data()));
+			offset = s32(diff);
+			return offset == diff;
+		};
+		bool offsets_in_range = Offset(&cycle, jit_offsets.cycle)
+			&& Offset(&flags.n_result, jit_offsets.n_result)
+			&& Offset(&flags.z_result, jit_offsets.z_result)
+			&& Offset(&flags.carry, jit_offsets.carry)
+			&& Offset(&flags.overflow, jit_offsets.overflow)
+			&& Offset(&pipeline.step, jit_offsets.pipeline_step)
+			&& Offset(&exception_has_occurred, jit_offsets.exception_has_occurred)
+			&& Offset(&block_invalidated, jit_offsets.block_invalidated)
+			&& Offset(&Scheduler::next_deadline, jit_offsets.next_deadline)
+			&& Offset(&Bus::next_addr_for_sequential_access, jit_offsets.next_sequential_addr);
+		if (!offsets_in_range) {
+			UserMessage::Show("The JIT cannot address the emulator state; using the cached interpreter.", UserMessage::Type::Warning);
+			return false;
+		}
+#ifdef _WIN32
+		SYSTEM_INFO system_info;
+		GetSystemInfo(&system_info);
+		jit_page_size = system_info.dwPageSize;
+		void* buffer = VirtualAlloc(nullptr, jit_code_buffer_capacity, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+		jit_page_size = size_t(sysconf(_SC_PAGESIZE));
+		void* buffer = mmap(nullptr, jit_code_buffer_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (buffer == MAP_FAILED) buffer = nullptr;
+#endif
+		if (!buffer) {
+			UserMessage::Show("Failed to allocate memory for the JIT; using the cached interpreter.", UserMessage::Type::Warning);
+			return false;
+		}
+		jit_code_buffer = static_cast<u8*>(buffer);
+		jit_code_size = 0;
+		return true;
+	}
+
+
+	template<std::integral Opcode>
+	u64 GetJitPrefetchedFetchCycles(u32 addr)
+	{
+		return 1 + Bus::GetPrefetchedCodeCycles<Opcode>(addr, Bus::AdvanceSequentialAccess<Opcode>(addr));
+	}
+
+
+	void HandleJitException()
+	{
+		exception_handler();
+		exception_has_occurred = false;
+	}
+
+
+	void ResetJitCode()
+	{
+		/* Code of a block that is running stays intact until the block returns, since nothing is emitted before then.
+		   The code of blocks removed from the cache is only reclaimed here. */
+		for (auto& [addr, block] : arm_blocks) block.jit_code = nullptr;
+		for (auto& [addr, block] : thumb_blocks) block.jit_code = nullptr;
+		jit_code_size = 0;
+	}
+
+
+	bool SetJitCodeWritable(u8* code_ptr, size_t size, bool writable)
+	{
+		/* The pages holding new code are writable while it is copied in, and executable otherwise, never both */
+		uintptr_t begin = reinterpret_cast<uintptr_t>(code_ptr) & ~(jit_page_size - 1);
+		uintptr_t end = (reinterpret_cast<uintptr_t>(code_ptr) + size + jit_page_size - 1) & ~(jit_page_size - 1);
+#ifdef _WIN32
+		DWORD old_protect;
+		if (!VirtualProtect(reinterpret_cast<void*>(begin), end - begin, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &old_protect)) {
+			return false;
+		}
+		return writable || FlushInstructionCache(GetCurrentProcess(), code_ptr, size);
+#else
+		return mprotect(reinterpret_cast<void*>(begin), end - begin, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#endif
+	}
+
+
+	template bool CompileBlock<ExecutionState::ARM>(Block<ExecutionState::ARM>&, u32);
+	template bool CompileBlock<ExecutionState::THUMB>(Block<ExecutionState::THUMB>&, u32);
+}
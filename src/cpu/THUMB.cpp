@@ -33,114 +33,118 @@ namespace CPU
 	}
 
 
-	void DecodeExecuteTHUMB(u16 opcode)
+	template<u16 index /* opcode bits 15-6 */ >
+	constexpr ThumbHandler DecodeTHUMB()
 	{
-		switch (opcode >> 12 & 0xF) {
-		case 0b0000:
-		case 0b0001:
-			(opcode & 0x1800) == 0x1800
-				? AddSubtract(opcode)
-				: Shift(opcode);
-			break;
-
-		case 0b0010:
-		case 0b0011:
-			MoveCompareAddSubtractImm(opcode);
-			break;
+		constexpr u16 opcode = index << 6;
+		constexpr u16 format = opcode >> 12 & 0xF;
 
-		case 0b0100:
-			if (opcode & 0x800) {
-				PcRelativeLoad(opcode);
+		if constexpr (format == 0b0000 || format == 0b0001) {
+			if constexpr ((opcode & 0x1800) == 0x1800) {
+				return AddSubtract<(opcode >> 10 & 1), (opcode >> 9 & 1)>;
 			}
-			else if (opcode & 0x400) {
-				HiReg(opcode);
+			else {
+				return Shift<(opcode >> 11 & 3)>;
+			}
+		}
+		else if constexpr (format == 0b0010 || format == 0b0011) {
+			return MoveCompareAddSubtractImm<(opcode >> 11 & 3)>;
+		}
+		else if constexpr (format == 0b0100) {
+			if constexpr (opcode & 0x800) {
+				return PcRelativeLoad;
+			}
+			else if constexpr (opcode & 0x400) {
+				return HiReg<(opcode >> 8 & 3), (opcode >> 7 & 1), (opcode >> 6 & 1)>;
 			}
 			else {
 				using enum ThumbAluInstruction;
-				switch (opcode >> 6 & 0xF) {
-				case  0: AluOperation<AND>(opcode); break;
-				case  1: AluOperation<EOR>(opcode); break;
-				case  2: AluOperation<LSL>(opcode); break;
-				case  3: AluOperation<LSR>(opcode); break;
-				case  4: AluOperation<ASR>(opcode); break;
-				case  5: AluOperation<ADC>(opcode); break;
-				case  6: AluOperation<SBC>(opcode); break;
-				case  7: AluOperation<ROR>(opcode); break;
-				case  8: AluOperation<TST>(opcode); break;
-				case  9: AluOperation<NEG>(opcode); break;
-				case 10: AluOperation<CMP>(opcode); break;
-				case 11: AluOperation<CMN>(opcode); break;
-				case 12: AluOperation<ORR>(opcode); break;
-				case 13: AluOperation<MUL>(opcode); break;
-				case 14: AluOperation<BIC>(opcode); break;
-				case 15: AluOperation<MVN>(opcode); break;
-				default: std::unreachable();
-				}
+				constexpr std::array instr_by_opcode = {
+					AND, EOR, LSL, LSR, ASR, ADC, SBC, ROR, TST, NEG, CMP, CMN, ORR, MUL, BIC, MVN
+				};
+				return AluOperation<instr_by_opcode[opcode >> 6 & 0xF]>;
 			}
-			break;
-
-		case 0b0101:
-			opcode & 0x200
-				? LoadStoreSignExtendedByteHalfword(opcode)
-				: LoadStoreRegOffset(opcode);
-			break;
-
-		case 0b0110:
-			LoadStoreImmOffset<0>(opcode);
-			break;
-
-		case 0b0111:
-			LoadStoreImmOffset<1>(opcode);
-			break;
-
-		case 0b1000:
-			LoadStoreHalfword(opcode);
-			break;
+		}
+		else if constexpr (format == 0b0101) {
+			if constexpr (opcode & 0x200) {
+				return LoadStoreSignExtendedByteHalfword<(opcode >> 10 & 3)>;
+			}
+			else {
+				return LoadStoreRegOffset<(opcode >> 11 & 1), (opcode >> 10 & 1)>;
+			}
+		}
+		else if constexpr (format == 0b0110) {
+			return LoadStoreImmOffset<0, (opcode >> 11 & 1)>;
+		}
+		else if constexpr (format == 0b0111) {
+			return LoadStoreImmOffset<1, (opcode >> 11 & 1)>;
+		}
+		else if constexpr (format == 0b1000) {
+			return LoadStoreHalfword<(opcode >> 11 & 1)>;
+		}
+		else if constexpr (format == 0b1001) {
+			return SpRelativeLoadStore<(opcode >> 11 & 1)>;
+		}
+		else if constexpr (format == 0b1010) {
+			return LoadAddress<(opcode >> 11 & 1)>;
+		}
+		else if constexpr (format == 0b1011) {
+			if constexpr (opcode & 0x400) {
+				return PushPopRegisters<(opcode >> 11 & 1), (opcode >> 8 & 1)>;
+			}
+			else {
+				return AddOffsetToStackPointer<(opcode >> 7 & 1)>;
+			}
+		}
+		else if constexpr (format == 0b1100) {
+			return MultipleLoadStore<(opcode >> 11 & 1)>;
+		}
+		else if constexpr (format == 0b1101) {
+			if constexpr ((opcode & 0xF00) == 0xF00) {
+				return [](u16 opcode) { SoftwareInterrupt(opcode & 0xFF); };
+			}
+			else {
+				return ConditionalBranch<(opcode >> 8 & 0xF)>;
+			}
+		}
+		else if constexpr (format == 0b1110) {
+			return UnconditionalBranch;
+		}
+		else {
+			return LongBranchWithLink<(opcode >> 11 & 1)>;
+		}
+	}
 
-		case 0b1001:
-			SpRelativeLoadStore(opcode);
-			break;
 
-		case 0b1010:
-			LoadAddress(opcode);
-			break;
+	template<size_t... indices>
+	constexpr std::array<ThumbHandler, sizeof...(indices)> MakeThumbHandlerTable(std::index_sequence<indices...>)
+	{
+		return { DecodeTHUMB<indices>()... };
+	}
 
-		case 0b1011:
-			opcode & 0x400
-				? PushPopRegisters(opcode)
-				: AddOffsetToStackPointer(opcode);
-			break;
 
-		case 0b1100:
-			MultipleLoadStore(opcode);
-			break;
+	/* Indexed by opcode bits 15-6 */
+	constexpr std::array<ThumbHandler, 0x400> thumb_handlers = MakeThumbHandlerTable(std::make_index_sequence<0x400>{});
 
-		case 0b1101:
-			(opcode & 0xF00) == 0xF00
-				? SoftwareInterrupt()
-				: ConditionalBranch(opcode);
-			break;
 
-		case 0b1110: 
-			UnconditionalBranch(opcode);
-			break;
+	void DecodeExecuteTHUMB(u16 opcode)
+	{
+		GetThumbHandler(opcode)(opcode);
+	}
 
-		case 0b1111:
-			LongBranchWithLink(opcode);
-			break;
 
-		default:
-			std::unreachable();
-		}
+	ThumbHandler GetThumbHandler(u16 opcode)
+	{
+		return thumb_handlers[opcode >> 6];
 	}
 
 
+	template<u16 op>
 	void Shift(u16 opcode) /* Format 1: ASR, LSL, LSR */
 	{
 		auto rd = opcode & 7;
 		auto rs = opcode >> 3 & 7;
 		auto shift_amount = opcode >> 6 & 0x1F;
-		auto op = opcode >> 11 & 3;
 
 		auto result = [&] {
 			switch (op) {
@@ -150,29 +154,29 @@ namespace CPU
 					return r[rs];
 				}
 				else {
-					cpsr.carry = GetBit(r[rs], 32 - shift_amount);
+					flags.carry = GetBit(r[rs], 32 - shift_amount);
 					return r[rs] << shift_amount;
 				}
 
 			case 0b01: /* LSR */
 				if (shift_amount == 0) {
 					/* LSR#0: Interpreted as LSR#32, ie. Rd becomes zero, C becomes Bit 31 of Rs */
-					cpsr.carry = GetBit(r[rs], 31);
+					flags.carry = GetBit(r[rs], 31);
 					return 0u;
 				}
 				else {
-					cpsr.carry = GetBit(r[rs], shift_amount - 1);
+					flags.carry = GetBit(r[rs], shift_amount - 1);
 					return u32(r[rs]) >> shift_amount;
 				}
 
 			case 0b10: /* ASR */
 				if (shift_amount == 0) {
 					/* ASR#0: Interpreted as ASR#32, ie. Rd and C are filled by Bit 31 of Rs. */
-					cpsr.carry = GetBit(r[rs], 31);
-					return cpsr.carry ? 0xFFFF'FFFF : 0;
+					flags.carry = GetBit(r[rs], 31);
+					return flags.carry ? 0xFFFF'FFFF : 0;
 				}
 				else {
-					cpsr.carry = GetBit(r[rs], shift_amount - 1);
+					flags.carry = GetBit(r[rs], shift_amount - 1);
 					return u32(s32(r[rs]) >> shift_amount);
 				}
 
@@ -182,81 +186,74 @@ namespace CPU
 		}();
 
 		r[rd] = result;
-		cpsr.zero = result == 0;
-		cpsr.negative = GetBit(result, 31);
+		flags.n_result = flags.z_result = result;
 	}
 
 
+	template<bool reg_or_imm /* 0=Register; 1=Immediate */, bool op /* 0=ADD; 1=SUB */ >
 	void AddSubtract(u16 opcode) /* Format 2: ADD, SUB */
 	{
 		auto rd = opcode & 7;
 		auto rs = opcode >> 3 & 7;
 		auto offset = opcode >> 6 & 7;
-		bool op = opcode >> 9 & 1;
-		bool reg_or_imm = opcode >> 10 & 1; /* 0=Register; 1=Immediate */
 
 		u32 oper1 = r[rs];
 		u32 oper2 = reg_or_imm ? offset : r[offset];
 
 		auto result = [&] {
-			if (op == 0) { /* ADD */
+			if constexpr (op == 0) { /* ADD */
 				u64 result = u64(oper1) + u64(oper2);
-				cpsr.carry = result > std::numeric_limits<u32>::max();
-				cpsr.overflow = GetBit((oper1 ^ result) & (oper2 ^ result), 31);
+				flags.carry = result > std::numeric_limits<u32>::max();
+				flags.overflow = GetBit((oper1 ^ result) & (oper2 ^ result), 31);
 				return u32(result);
 			}
 			else { /* SUB */
 				u32 result = oper1 - oper2;
-				cpsr.carry = oper2 <= oper1; /* this is not borrow */
-				cpsr.overflow = GetBit((oper1 ^ oper2) & (oper1 ^ result), 31);
+				flags.carry = oper2 <= oper1; /* this is not borrow */
+				flags.overflow = GetBit((oper1 ^ oper2) & (oper1 ^ result), 31);
 				return result;
 			}
 		}();
 
 		r[rd] = result;
-		cpsr.zero = result == 0;
-		cpsr.negative = GetBit(result, 31);
+		flags.n_result = flags.z_result = result;
 	}
 
 
+	template<u16 op>
 	void MoveCompareAddSubtractImm(u16 opcode) /* Format 3: ADD, CMP, MOV, SUB */
 	{
 		u8 imm = opcode & 0xFF;
 		auto rd = opcode >> 8 & 7;
-		auto op = opcode >> 11 & 3;
 
 		switch (op) {
 		case 0b00: /* MOV */
 			r[rd] = imm;
-			cpsr.negative = 0;
-			cpsr.zero = r[rd] == 0;
+			flags.n_result = flags.z_result = r[rd]; /* N is always cleared, as imm is 8-bit */
 			break;
 
 		case 0b01: { /* CMP */
 			u32 result = r[rd] - imm;
-			cpsr.overflow = GetBit((r[rd] ^ imm) & (r[rd] ^ result), 31);
-			cpsr.carry = imm <= r[rd];
-			cpsr.negative = GetBit(result, 31);
-			cpsr.zero = result == 0;
+			flags.overflow = GetBit((r[rd] ^ imm) & (r[rd] ^ result), 31);
+			flags.carry = imm <= r[rd];
+			flags.n_result = flags.z_result = u32(result);
 			break;
 		}
 
 		case 0b10: { /* ADD */
 			u64 result = u64(r[rd]) + u64(imm);
-			cpsr.overflow = GetBit((r[rd] ^ result) & (imm ^ result), 31);
-			cpsr.carry = result > std::numeric_limits<u32>::max();
-			cpsr.negative = GetBit(result, 31);
-			cpsr.zero = u32(result) == 0;
+			flags.overflow = GetBit((r[rd] ^ result) & (imm ^ result), 31);
+			flags.carry = result > std::numeric_limits<u32>::max();
+			flags.n_result = flags.z_result = u32(result);
 			r[rd] = u32(result);
 			break;
 		}
 
 		case 0b11: { /* SUB */
 			u32 result = r[rd] - imm;
-			cpsr.overflow = GetBit((r[rd] ^ imm) & (r[rd] ^ result), 31);
-			cpsr.carry = imm <= r[rd];
-			cpsr.negative = GetBit(result, 31);
-			cpsr.zero = result == 0;
+			flags.overflow = GetBit((r[rd] ^ imm) & (r[rd] ^ result), 31);
+			flags.carry = imm <= r[rd];
+			flags.n_result = flags.z_result = u32(result);
 			r[rd] = result;
 			break;
 		}
@@ -289,8 +286,8 @@ namespace CPU
 
 		auto result = [&] {
 			if constexpr (instr == ADC) {
-				u64 result = u64(op1) + u64(op2) + u64(cpsr.carry);
-				cpsr.carry = result > std::numeric_limits<u32>::max();
+				u64 result = u64(op1) + u64(op2) + u64(flags.carry);
+				flags.carry = result > std::numeric_limits<u32>::max();
 				return u32(result);
 			}
 			if constexpr (instr == AND || instr == TST) {
@@ -302,12 +299,12 @@ namespace CPU
 					return op1;
 				}
 				else if (shift_amount < 32) {
-					cpsr.carry = GetBit(op1, shift_amount - 1);
+					flags.carry = GetBit(op1, shift_amount - 1);
 					return u32(s32(op1) >> shift_amount);
 				}
 				else {
 					bool bit31 = GetBit(op1, 31);
-					cpsr.carry = bit31;
+					flags.carry = bit31;
 					return bit31 ? 0xFFFF'FFFFu : 0u;
 				}
 			}
@@ -316,11 +313,11 @@ namespace CPU
 			}
 			if constexpr (instr == CMN) {
 				u64 result = u64(op1) + u64(op2);
-				cpsr.carry = result > std::numeric_limits<u32>::max();
+				flags.carry = result > std::numeric_limits<u32>::max();
 				return u32(result);
 			}
 			if constexpr (instr == CMP) {
-				cpsr.carry = op2 <= op1;
+				flags.carry = op2 <= op1;
 				return op1 - op2;
 			}
 			if constexpr (instr == EOR) {
@@ -332,11 +329,11 @@ namespace CPU
 					return op1;
 				}
 				else if (shift_amount < 32) {
-					cpsr.carry = GetBit(op1, 32 - shift_amount);
+					flags.carry = GetBit(op1, 32 - shift_amount);
 					return op1 << shift_amount;
 				}
 				else {
-					cpsr.carry = shift_amount == 32 ? GetBit(op1, 0) : 0;
+					flags.carry = shift_amount == 32 ? GetBit(op1, 0) : 0;
 					return 0u;
 				}
 			}
@@ -346,23 +343,23 @@ namespace CPU
 					return op1;
 				}
 				else if (shift_amount < 32) {
-					cpsr.carry = GetBit(op1, shift_amount - 1);
+					flags.carry = GetBit(op1, shift_amount - 1);
 					return u32(op1) >> shift_amount;
 				}
 				else {
-					cpsr.carry = shift_amount > 32 ? 0 : GetBit(op1, 31);
+					flags.carry = shift_amount > 32 ? 0 : GetBit(op1, 31);
 					return 0u;
 				}
 			}
 			if constexpr (instr == MUL) {
-				cpsr.carry = 0;
+				flags.carry = 0;
 				return op1 * op2;
 			}
 			if constexpr (instr == MVN) {
 				return ~op2;
 			}
 			if constexpr (instr == NEG) {
-				cpsr.carry = op2 == 0; /* TODO: unsure */
+				flags.carry = op2 == 0; /* TODO: unsure */
 				return u32(-s32(op2));
 			}
 			if constexpr (instr == ORR) {
@@ -374,13 +371,13 @@ namespace CPU
 					return op1;
 				}
 				else {
-					cpsr.carry = op1 >> ((shift_amount - 1) & 0x1F) & 1;
+					flags.carry = op1 >> ((shift_amount - 1) & 0x1F) & 1;
 					return std::rotr(op1, shift_amount);
 				}
 			}
 			if constexpr (instr == SBC) {
-				auto result = op1 - op2 - !cpsr.carry;
-				cpsr.carry = u64(op2) + u64(!cpsr.carry) <= u64(op1);
+				auto result = op1 - op2 - !flags.carry;
+				flags.carry = u64(op2) + u64(!flags.carry) <= u64(op1);
 				return result;
 			}
 		}();
@@ -388,24 +385,22 @@ namespace CPU
 		if constexpr (!OneOf(instr, CMP, CMN, TST)) {
 			r[rd] = result;
 		}
-		cpsr.zero = result == 0;
-		cpsr.negative = GetBit(result, 31);
+		flags.n_result = flags.z_result = result;
 		if constexpr (is_arithmetic_instr) {
 			auto cond = [&] {
 				if constexpr (instr == ADC || instr == CMN) return (op1 ^ result) & (op2 ^ result);
 				if constexpr (instr == CMP || instr == SBC) return (op1 ^ op2) & (op1 ^ result);
 				if constexpr (instr == NEG)                 return op2 & result; /* SUB with op1 == 0 */
 			}();
-			cpsr.overflow = GetBit(cond, 31);
+			flags.overflow = GetBit(cond, 31);
 		}
 	}
 
 
+	template<u16 op, bool h1, bool h2>
 	void HiReg(u16 opcode) /* Format 5: ADD, BX, CMP, MOV */
 	{
 		auto rs = opcode >> 3 & 7;
-		auto h2 = opcode >> 6 & 1;
-		auto op = opcode >> 8 & 3;
 		rs += h2 << 3; /* add 8 to register indeces if h flags are set */
 		auto oper = r[rs];
 		if (rs == 15) { /* If R15 is used as an operand, the value will be the address of the instruction + 4 with bit 0 cleared. */
@@ -415,7 +410,6 @@ namespace CPU
 		switch (op) {
 		case 0b00: { /* ADD */
 			auto rd = opcode & 7;
-			auto h1 = opcode >> 7 & 1;
 			rd += h1 << 3;
 			r[rd] += oper;
 			if (rd == 15) {
@@ -427,19 +421,16 @@ namespace CPU
 
 		case 0b01: { /* CMP */
 			auto rd = opcode & 7;
-			auto h1 = opcode >> 7 & 1;
 			rd += h1 << 3;
 			auto result = r[rd] - oper;
-			cpsr.overflow = GetBit((r[rd] ^ oper) & (r[rd] ^ result), 31);
-			cpsr.carry = oper <= r[rd];
-			cpsr.zero = result == 0;
-			cpsr.negative = GetBit(result, 31);
+			flags.overflow = GetBit((r[rd] ^ oper) & (r[rd] ^ result), 31);
+			flags.carry = oper <= r[rd];
+			flags.n_result = flags.z_result = result;
 			break;
 		}
 
 		case 0b10: { /* MOV */
 			auto rd = opcode & 7;
-			auto h1 = opcode >> 7 & 1;
 			rd += h1 << 3;
 			r[rd] = oper;
 			if (rd == 15) {
@@ -476,29 +467,28 @@ namespace CPU
 	}
 
 
+	template<bool load_or_store /* 0: store; 1: load */, bool byte_or_word /* 0: word; 1: byte */ >
 	void LoadStoreRegOffset(u16 opcode) /* Format 7: LDR, LDRB, STR, STRB */
 	{
 		auto rd = opcode & 7;
 		auto rb = opcode >> 3 & 7;
 		auto ro = opcode >> 6 & 7;
-		bool byte_or_word = opcode >> 10 & 1; /* 0: word; 1: byte */
-		bool load_or_store = opcode >> 11 & 1; /* 0: store; 1: load */
 		auto addr = r[rb] + r[ro];
-		if (load_or_store == 0) { /* store */
+		if constexpr (load_or_store == 0) { /* store */
 			byte_or_word ? Bus::Write<u8>(addr, u8(r[rd])) : Bus::Write<u32>(addr, r[rd]);
 		}
 		else { /* load */
-			r[rd] = byte_or_word ? Bus::Read<u8>(addr) : Bus::Read<u32>(addr); 
+			r[rd] = byte_or_word ? Bus::Read<u8>(addr) : Bus::Read<u32>(addr);
 		}
 	}
 
 
+	template<u16 op>
 	void LoadStoreSignExtendedByteHalfword(u16 opcode) /* Format 8: LDSB, LDRH, LDSH, STRH */
 	{
 		auto rd = opcode & 7;
 		auto rb = opcode >> 3 & 7;
 		auto ro = opcode >> 6 & 7;
-		auto op = opcode >> 10 & 3;
 		auto addr = r[rb] + r[ro];
 		switch (op) {
 		case 0b00: /* Store halfword */
@@ -523,17 +513,16 @@ namespace CPU
 	}
 
 
-	template<bool byte_or_word /* 0: word; 1: byte */ >
+	template<bool byte_or_word /* 0: word; 1: byte */, bool load_or_store /* 0: store; 1: load */ >
 	void LoadStoreImmOffset(u16 opcode) /* Format 9: LDR, LDRB, STR, STRB */
 	{
 		auto rd = opcode & 7;
 		auto rb = opcode >> 3 & 7;
-		bool load_or_store = opcode >> 11 & 1; /* 0: store; 1: load */
 		/* unsigned offset is 0-31 for byte, 0-124 (step 4) for word */
 		if constexpr (byte_or_word == 0) { /* word */
 			auto offset = opcode >> 4 & 0x7C; /* == (opcode >> 6 & 0x1F) << 2 */
 			auto addr = r[rb] + offset;
-			if (load_or_store == 0) {
+			if constexpr (load_or_store == 0) {
 				Bus::Write<u32>(addr, r[rd]);
 			}
 			else {
@@ -543,7 +532,7 @@ namespace CPU
 		else { /* byte */
 			auto offset = opcode >> 6 & 0x1F;
 			auto addr = r[rb] + offset;
-			if (load_or_store == 0) {
+			if constexpr (load_or_store == 0) {
 				Bus::Write<u8>(addr, u8(r[rd]));
 			}
 			else {
@@ -553,14 +542,14 @@ namespace CPU
 	}
 
 
+	template<bool load_or_store /* 0: store; 1: load */ >
 	void LoadStoreHalfword(u16 opcode) /* Format 10: LDRH, STRH */
 	{
 		auto rd = opcode & 7;
 		auto rb = opcode >> 3 & 7;
 		auto offset = opcode >> 5 & 0x3E; /* == (opcode >> 6 & 0x1F) << 1 */
-		bool load_or_store = opcode >> 11 & 1; /* 0: store; 1: load */
 		auto addr = r[rb] + offset;
-		if (load_or_store == 0) { 
+		if constexpr (load_or_store == 0) {
 			Bus::Write<u16>(addr, r[rd]);
 		}
 		else {
@@ -569,13 +558,13 @@ namespace CPU
 	}
 
 
+	template<bool load_or_store /* 0: store; 1: load */ >
 	void SpRelativeLoadStore(u16 opcode) /* Format 11: LDR, STR */
 	{
 		u8 immediate = opcode & 0xFF;
 		auto rd = opcode >> 8 & 7;
-		bool load_or_store = opcode >> 11 & 1; /* 0: store; 1: load */
-		auto addr = sp + (immediate << 2); 
-		if (load_or_store == 0) {
+		auto addr = sp + (immediate << 2);
+		if constexpr (load_or_store == 0) {
 			Bus::Write<u32>(addr, r[rd]);
 		}
 		else {
@@ -584,12 +573,12 @@ namespace CPU
 	}
 
 
+	template<bool src /* 0: PC (r15); 1: SP (r13) */ >
 	void LoadAddress(u16 opcode) /* Format 12: ADD Rd,PC,#nn; ADD Rd,SP,#nn */
 	{
 		u8 immediate = opcode & 0xFF;
 		auto rd = opcode >> 8 & 7;
-		auto src = opcode >> 11 & 1; /* 0: PC (r15); 1: SP (r13) */
-		if (src == 0) {
+		if constexpr (src == 0) {
 			r[rd] = (pc & ~2) + (immediate << 2);
 		}
 		else {
@@ -598,22 +587,21 @@ namespace CPU
 	}
 
 
+	template<bool sign /* 0: positive offset; 1: negative offset */ >
 	void AddOffsetToStackPointer(u16 opcode) /* Format 13: ADD SP,#nn */
 	{
 		s16 offset = (opcode & 0x7F) << 2;
-		bool sign = opcode >> 7 & 1; /* 0: positive offset; 1: negative offset */
-		if (sign == 1) {
+		if constexpr (sign == 1) {
 			offset = -offset; /* [-508, 508] in steps of 4 */
 		}
 		sp += offset;
 	}
 
 
+	template<bool load_or_store /* 0: store; 1: load */, bool transfer_lr_pc /* 0: Do not store LR / load PC; 1: Store LR / Load PC */ >
 	void PushPopRegisters(u16 opcode) /* Format 14: PUSH, POP */
 	{
 		auto reg_list = opcode & 0xFF;
-		bool transfer_lr_pc = opcode >> 8 & 1; /* 0: Do not store LR / load PC; 1: Store LR / Load PC */
-		bool load_or_store = opcode >> 11 & 1; /* 0: store; 1: load */
 
 		auto LoadReg = [&] {
 			u32 ret = Bus::Read<u32>(sp);
@@ -627,8 +615,8 @@ namespace CPU
 		};
 
 		/* The lowest register gets transferred to/from the lowest memory address. */
-		if (load_or_store == 0) {
-			if (transfer_lr_pc) {
+		if constexpr (load_or_store == 0) {
+			if constexpr (transfer_lr_pc) {
 				StoreReg(lr);
 			}
 			for (int i = 7; i >= 0; --i) {
@@ -643,7 +631,7 @@ namespace CPU
 					r[i] = LoadReg();
 				}
 			}
-			if (transfer_lr_pc) {
+			if constexpr (transfer_lr_pc) {
 				pc = LoadReg() & ~1;
 				FlushPipeline();
 			}
@@ -651,18 +639,18 @@ namespace CPU
 	}
 
 
+	template<bool load_or_store /* 0: store; 1: load */ >
 	void MultipleLoadStore(u16 opcode) /* Format 15: LDMIA, STMIA */
 	{
 		auto reg_list = opcode & 0xFF;
 		auto rb = opcode >> 8 & 7;
-		bool load_or_store = opcode >> 11 & 1; /* 0: store; 1: load */
 		/* Strange Effects on Invalid Rlist's
 			* Empty Rlist: R15 loaded/stored (ARMv4 only), and Rb=Rb+40h (ARMv4-v5).
 			* Writeback with Rb included in Rlist: Store OLD base if Rb is FIRST entry in Rlist,
 			otherwise store NEW base (STM/ARMv4). Always store OLD base (STM/ARMv5), no writeback (LDM/ARMv4/ARMv5).
 			TODO: emulate 2nd point
 		*/
-		if (load_or_store) {
+		if constexpr (load_or_store) {
 			if (reg_list == 0) {
 				pc = Bus::Read<u32>(r[rb]);
 				r[rb] += 0x40;
@@ -696,9 +684,9 @@ namespace CPU
 	}
 
 
+	template<u16 cond>
 	void ConditionalBranch(u16 opcode) /* Format 16: BEQ, BNE, BCS, BCC, BMI, BPL, BVS, BVC, BHI, BLS, BGE, BLT, BGT, BLE */
 	{
-		auto cond = opcode >> 8 & 0xF;
 		bool branch = CheckCondition(cond);
 		if (branch) {
 			s32 offset = SignExtend<s32, 9>(opcode << 1 & 0x1FE); /* [-256, 254] in steps of 2 */
@@ -708,8 +696,11 @@ namespace CPU
 	}
 
 
-	void SoftwareInterrupt() /* Format 17: SWI */
+	void SoftwareInterrupt(u8 comment) /* Format 17: SWI; also used for ARM SWIs */
 	{
+		if (hle_bios && HleSoftwareInterrupt(comment)) {
+			return;
+		}
 		SignalException<Exception::SoftwareInterrupt>();
 	}
 
@@ -722,11 +713,11 @@ namespace CPU
 	}
 
 
+	template<bool low_or_high_offset /* 0: offset high; 1: offset low */ >
 	void LongBranchWithLink(u16 opcode) /* Format 19: BL */
 	{
 		auto immediate = opcode & 0x7FF;
-		bool low_or_high_offset = opcode >> 11 & 1; /* 0: offset high; 1: offset low */
-		if (low_or_high_offset == 0) {
+		if constexpr (low_or_high_offset == 0) {
 			s32 offset = SignExtend<s32, 23>(immediate << 12);
 			lr = pc + offset;
 		}
@@ -4,6 +4,86 @@ import Bus;
 
 namespace PPU
 {
+	std::span<const u32> GetBlockWriteGenerations(VideoMemory memory)
+	{
+		switch (memory) {
+		case VideoMemory::Oam:        return oam_block_generations;
+		case VideoMemory::PaletteRam: return palette_block_generations;
+		case VideoMemory::Vram:       return vram_block_generations;
+		default: std::unreachable();
+		}
+	}
+
+
+	u32 GetFrameGeneration()
+	{
+		return frame_generation;
+	}
+
+
+	u8* GetOamPointer(u32 addr)
+	{
+		return oam.data() + (addr & 0x3FF);
+	}
+
+
+	u8* GetPaletteRamPointer(u32 addr)
+	{
+		return palette_ram.data() + (addr & 0x3FF);
+	}
+
+
+	u8* GetVramPointer(u32 addr)
+	{
+		return vram.data() + (addr % 0x18000);
+	}
+
+
+	u32 GetWriteGeneration(VideoMemory memory)
+	{
+		switch (memory) {
+		case VideoMemory::Oam:        return oam_write_generation;
+		case VideoMemory::PaletteRam: return palette_write_generation;
+		case VideoMemory::Vram:       return vram_write_generation;
+		default: std::unreachable();
+		}
+	}
+
+
+	void MarkDirty(u32 addr, uint size)
+	{
+		switch (addr >> 24 & 0xF) {
+		case 0x5:
+			MarkDirtyBlocks<palette_block_shift>(palette_block_generations, addr & 0x3FF, size);
+			palette_write_generation = frame_generation;
+			break;
+
+		case 0x6:
+			MarkDirtyBlocks<vram_block_shift>(vram_block_generations, addr % 0x18000, size);
+			vram_write_generation = frame_generation;
+			break;
+
+		case 0x7:
+			MarkDirtyBlocks<oam_block_shift>(oam_block_generations, addr & 0x3FF, size);
+			oam_write_generation = frame_generation;
+			break;
+		}
+	}
+
+
+	template<uint block_shift, size_t size>
+	void MarkDirtyBlocks(std::array<u32, size>& generations, u32 offset, uint access_size)
+	{
+		/* Accesses are smaller than a block, so at most two blocks are touched */
+		u32 first_block = offset >> block_shift;
+		u32 last_block = (offset + access_size - 1) >> block_shift;
+		generations[first_block] = frame_generation;
+		if (last_block != first_block && last_block < size) {
+			generations[last_block] = frame_generation;
+		}
+	}
+
+
 	template<std::integral Int>
 	Int ReadOam(u32 addr)
 	{
@@ -114,6 +194,8 @@ namespace PPU
 	void WriteOam(u32 addr, Int data)
 	{
 		std::memcpy(oam.data() + (addr & 0x3FF), &data, sizeof(Int));
+		MarkDirtyBlocks<oam_block_shift>(oam_block_generations, addr & 0x3FF, sizeof(Int));
+		oam_write_generation = frame_generation;
 		//if (dispcnt.forced_blank || in_vblank || in_hblank && dispcnt.hblank_interval_free) {
 		//	std::memcpy(oam.data() + (addr & 0x3FF), &data, sizeof(Int));
 		//}
@@ -124,6 +206,8 @@ namespace PPU
 	void WritePaletteRam(u32 addr, Int data)
 	{
 		std::memcpy(palette_ram.data() + (addr & 0x3FF), &data, sizeof(Int));
+		MarkDirtyBlocks<palette_block_shift>(palette_block_generations, addr & 0x3FF, sizeof(Int));
+		palette_write_generation = frame_generation;
 		//if (dispcnt.forced_blank || in_vblank || in_hblank) {
 		//	std::memcpy(palette_ram.data() + (addr & 0x3FF), &data, sizeof(Int));
 		//}
@@ -281,6 +365,8 @@ namespace PPU
 	void WriteVram(u32 addr, Int data)
 	{
 		std::memcpy(vram.data() + (addr % 0x18000), &data, sizeof(Int));
+		MarkDirtyBlocks<vram_block_shift>(vram_block_generations, addr % 0x18000, sizeof(Int));
+		vram_write_generation = frame_generation;
 		//if (dispcnt.forced_blank || in_vblank || in_hblank) {
 		//	std::memcpy(vram.data() + (addr % 0x18000), &data, sizeof(Int));
 		//}
@@ -49,6 +49,11 @@ namespace PPU
 		oam.fill(0);
 		palette_ram.fill(0);
 		vram.fill(0);
+		/* Everything counts as written after a reset. The frame generation keeps counting, so that consumers notice. */
+		oam_block_generations.fill(frame_generation);
+		palette_block_generations.fill(frame_generation);
+		vram_block_generations.fill(frame_generation);
+		oam_write_generation = palette_write_generation = vram_write_generation = frame_generation;
 		objects.clear();
 		objects.reserve(128);
 
@@ -59,7 +64,7 @@ namespace PPU
 	}
 
 
-	void OnHBlank()
+	void OnHBlank(u64)
 	{
 		Scheduler::AddEvent(Scheduler::EventType::HBlankSetFlag, cycles_until_set_hblank_flag - cycles_until_hblank, OnHBlankSetFlag);
 		in_hblank = true;
@@ -67,7 +72,7 @@ namespace PPU
 	}
 
 
-	void OnHBlankSetFlag()
+	void OnHBlankSetFlag(u64)
 	{
 		Scheduler::AddEvent(Scheduler::EventType::NewScanline, cycles_per_line - cycles_until_set_hblank_flag, OnNewScanline);
 		dispstat.hblank = 1;
@@ -77,7 +82,7 @@ namespace PPU
 	}
 	
 
-	void OnNewScanline()
+	void OnNewScanline(u64)
 	{
 		if (v_counter < lines_until_vblank) {
 			RenderScanline();
@@ -100,6 +105,7 @@ namespace PPU
 		}
 		else if (v_counter == lines_until_vblank) {
 			framebuffer_index = 0;
+			++frame_generation;
 			Video::NotifyNewGameFrameReady();
 			dispstat.vblank = in_vblank = true;
 			if (dispstat.vblank_irq_enable) {
@@ -9,6 +9,7 @@ import <cmath>;
 import <concepts>;
 import <cstring>;
 import <iterator>;
+import <span>;
 import <utility>;
 import <vector>;
 
@@ -16,8 +17,24 @@ namespace PPU
 {
 	export
 	{
+		enum class VideoMemory {
+			Oam, PaletteRam, Vram
+		};
+
+		/* Size of the blocks that writes are tracked in */
+		constexpr uint oam_block_shift = 3; /* one OAM entry */
+		constexpr uint palette_block_shift = 5; /* one 16-colour palette bank */
+		constexpr uint vram_block_shift = 5; /* 32 bytes, i.e. one 4bpp tile */
+
 		void AddInitialEvents();
+		std::span<const u32> GetBlockWriteGenerations(VideoMemory memory);
+		u32 GetFrameGeneration();
+		u8* GetOamPointer(u32 addr);
+		u8* GetPaletteRamPointer(u32 addr);
+		u8* GetVramPointer(u32 addr);
+		u32 GetWriteGeneration(VideoMemory memory);
 		void Initialize();
+		void MarkDirty(u32 addr, uint size);
 		template<std::integral Int> Int ReadOam(u32 addr);
 		template<std::integral Int> Int ReadPaletteRam(u32 addr);
 		template<std::integral Int> Int ReadReg(u32 addr);
@@ -73,14 +90,15 @@ namespace PPU
 		u8 oam_index;
 	};
 
+	template<uint block_shift, size_t size> void MarkDirtyBlocks(std::array<u32, size>& generations, u32 offset, uint access_size);
 	RGB AlphaBlend(RGB target_1, RGB target_2);
 	void BlendLayers();
 	RGB BrightnessDecrease(RGB pixel);
 	RGB BrightnessIncrease(RGB pixel);
 	BgColorData GetBackdropColor();
-	void OnHBlank();
-	void OnHBlankSetFlag();
-	void OnNewScanline();
+	void OnHBlank(u64);
+	void OnHBlankSetFlag(u64);
+	void OnNewScanline(u64);
 	void PushPixel(auto color_data);
 	void PushPixel(RGB rgb);
 	void PushPixel(u8 r, u8 g, u8 b);
@@ -245,4 +263,16 @@ namespace PPU
 	std::array<u8, 0x18000> vram;
 	std::vector<u8> framebuffer;
 	std::vector<ObjData> objects;
+
+	/* Write tracking of video memory, for consumers that cache data derived from it. Each write stamps the block it touches,
+	   and the memory as a whole, with the current frame generation, which is advanced at the start of each VBlank. A consumer
+	   remembers the frame generation at which it last looked, and treats the blocks stamped with that generation or a later one
+	   as changed, so that any number of consumers can track changes independently. Memory written directly through the host
+	   pointers must be marked with MarkDirty. */
+	std::array<u32, (0x400 >> oam_block_shift)> oam_block_generations;
+	std::array<u32, (0x400 >> palette_block_shift)> palette_block_generations;
+	std::array<u32, (0x18000 >> vram_block_shift)> vram_block_generations;
+
+	u32 frame_generation;
+	u32 oam_write_generation, palette_write_generation, vram_write_generation;
 }
\ No newline at end of file